@@ -25,9 +25,11 @@ Create Vertex Buffer
 /* This is part of the draw cube progression */
 
 #include <util_init.hpp>
+#include <device_allocator.hpp>
 #include <assert.h>
 #include <string.h>
 #include <cstdlib>
+#include "draw_benchmarks.hpp"
 
 
 
@@ -81,6 +83,20 @@ const char *vertShaderText =
     "  fragColor = inColor;\n"
     "}";
 
+// The same shader reading the matrix from push constants
+const char *pushConstantVertShaderText =
+    "#version 450\n"
+    "layout(push_constant) uniform pushConstants {\n"
+    "  mat4 uMVPMatrix;\n"
+    "};\n"
+    "layout(location = 0) in vec3 inPosition;\n"
+    "layout(location = 1) in vec3 inColor;\n"
+    "layout(location = 0) out vec3 fragColor;\n"
+    "void main() {\n"
+    "  gl_Position = uMVPMatrix * vec4(inPosition, 1.0);\n"
+    "  fragColor = inColor;\n"
+    "}";
+
 const char *fragShaderText =
     "#version 450\n"
     "layout(location = 0) out vec4 outColor;\n"
@@ -111,113 +127,96 @@ const std::vector<Vertex> vertices =
 };
 
 
+// Holds verticesIndexed, whose first three are vertices, so indexed draws have every vertex they index
 void createVertexBuffer(sample_info &info){
   VkResult U_ASSERT_ONLY res;
   bool U_ASSERT_ONLY pass;
 
-  VkBufferCreateInfo buf_info = {};
-  buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-  buf_info.pNext = NULL;
-  buf_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-  buf_info.size = sizeof(vertices);
-  buf_info.queueFamilyIndexCount = 0;
-  buf_info.pQueueFamilyIndices = NULL;
-  buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-  buf_info.flags = 0;
-  res = vkCreateBuffer(info.device, &buf_info, NULL, &info.vertex_buffer.buf);
-  assert(res == VK_SUCCESS);
-
-  VkMemoryRequirements mem_reqs;
-  vkGetBufferMemoryRequirements(info.device, info.vertex_buffer.buf, &mem_reqs);
-  VkMemoryAllocateInfo alloc_info = {};
-  alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  alloc_info.pNext = NULL;
-  alloc_info.memoryTypeIndex = 0;
-  alloc_info.allocationSize = mem_reqs.size;
-
-  pass = memory_type_from_properties(info, mem_reqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &alloc_info.memoryTypeIndex);
+  // Also a copy source, for the vertex_placement benchmark
+  const VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  if (info.device_local_buffers) {
+    init_device_local_buffer(info, usage, verticesIndexed.data(), verticesIndexed.size() * sizeof(Vertex),
+                             info.vertex_buffer.buf, info.vertex_buffer.mem);
+    info.vertex_buffer.buffer_info.range = verticesIndexed.size() * sizeof(Vertex);
+    info.vertex_buffer.buffer_info.offset = 0;
+  } else {
+    VkBufferCreateInfo buf_info = {};
+    buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buf_info.pNext = NULL;
+    buf_info.usage = usage;
+    buf_info.size = verticesIndexed.size() * sizeof(Vertex);
+    buf_info.queueFamilyIndexCount = 0;
+    buf_info.pQueueFamilyIndices = NULL;
+    buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    buf_info.flags = 0;
+    res = vkCreateBuffer(info.device, &buf_info, NULL, &info.vertex_buffer.buf);
+    assert(res == VK_SUCCESS);
 
-  assert(pass && "No mappable, coherent memory");
-  res = vkAllocateMemory(info.device, &alloc_info, NULL, &(info.vertex_buffer.mem));
-  assert(res == VK_SUCCESS);
+    pass = device_alloc_buffer(info, info.vertex_buffer.buf, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, info.vertex_buffer.mem);
+    assert(pass && "No mappable, coherent memory");
 
-  info.vertex_buffer.buffer_info.range = mem_reqs.size;
-  info.vertex_buffer.buffer_info.offset = 0;
+    info.vertex_buffer.buffer_info.range = info.vertex_buffer.mem.size;
+    info.vertex_buffer.buffer_info.offset = 0;
 
-  uint8_t *pData;
-  res = vkMapMemory(info.device, info.vertex_buffer.mem, 0, mem_reqs.size, 0, (void **)&pData);
-  assert(res == VK_SUCCESS);
-
-  memcpy(pData, vertices.data(), sizeof(vertices));
-  vkUnmapMemory(info.device, info.vertex_buffer.mem);
-  res = vkBindBufferMemory(info.device, info.vertex_buffer.buf, info.vertex_buffer.mem, 0);
-  assert(res == VK_SUCCESS);
+    memcpy(info.vertex_buffer.mem.mapped, verticesIndexed.data(), buf_info.size);
+  }
 
+  info.vertex_count = verticesIndexed.size();
   info.vi_binding = Vertex::getBindingDescription();
   info.vi_attribs[0] = Vertex::getAttributeDescriptions()[0];
   info.vi_attribs[1] = Vertex::getAttributeDescriptions()[1];
 }
 
-void createUniformBuffer(sample_info &info){
-  struct mvpMatrix uniformData = {};
-  uniformData.posX = 1.0f;
-  uniformData.posY = 1.0f;
-  uniformData.posZ = 1.0f;
-  uniformData.posW = 1.0f;
-
+void createIndexBuffer(sample_info &info){
   VkResult U_ASSERT_ONLY res;
   bool U_ASSERT_ONLY pass;
+
   VkBufferCreateInfo buf_info = {};
   buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   buf_info.pNext = NULL;
-  buf_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-  buf_info.size = sizeof(uniformData);
+  buf_info.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+  buf_info.size = indices.size() * sizeof(uint16_t);
   buf_info.queueFamilyIndexCount = 0;
   buf_info.pQueueFamilyIndices = NULL;
   buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
   buf_info.flags = 0;
-  res = vkCreateBuffer(info.device, &buf_info, NULL, &info.uniform_data.buf);
+  res = vkCreateBuffer(info.device, &buf_info, NULL, &info.index_buffer.buf);
   assert(res == VK_SUCCESS);
 
-  VkMemoryRequirements mem_reqs;
-  vkGetBufferMemoryRequirements(info.device, info.uniform_data.buf, &mem_reqs);
-  VkMemoryAllocateInfo alloc_info = {};
-  alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  alloc_info.pNext = NULL;
-  alloc_info.memoryTypeIndex = 0;
-  alloc_info.allocationSize = mem_reqs.size;
-
-  pass = memory_type_from_properties(info, mem_reqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &alloc_info.memoryTypeIndex);
-
-
+  pass = device_alloc_buffer(info, info.index_buffer.buf, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, info.index_buffer.mem);
   assert(pass && "No mappable, coherent memory");
-  res = vkAllocateMemory(info.device, &alloc_info, NULL, &(info.uniform_data.mem));
-  assert(res == VK_SUCCESS);
 
-  u_int8_t *pData;
-  res = vkMapMemory(info.device, info.uniform_data.mem, 0, mem_reqs.size, 0, (void**)&pData);
-  assert(res == VK_SUCCESS);
+  info.index_buffer.buffer_info.range = buf_info.size;
+  info.index_buffer.buffer_info.offset = 0;
 
-  memcpy(pData, &uniformData, sizeof(uniformData));
+  memcpy(info.index_buffer.mem.mapped, indices.data(), buf_info.size);
 
-  vkUnmapMemory(info.device, info.uniform_data.mem);
+  info.index_buffer.buffer_info.buffer = info.index_buffer.buf;
+  info.index_type = VK_INDEX_TYPE_UINT16;
+  info.index_count = indices.size();
+}
 
-  res = vkBindBufferMemory(info.device, info.uniform_data.buf, info.uniform_data.mem, 0);
-  assert(res == VK_SUCCESS);
+void createUniformBuffer(sample_info &info){
+  struct mvpMatrix uniformData = {};
+  uniformData.posX = 1.0f;
+  uniformData.posY = 1.0f;
+  uniformData.posZ = 1.0f;
+  uniformData.posW = 1.0f;
 
-  info.uniform_data.buffer_info.buffer = info.uniform_data.buf;
-  info.uniform_data.buffer_info.offset = 0;
-  info.uniform_data.buffer_info.range = sizeof(uniformData);
+  // One slot per frame in flight, like init_uniform_buffer(), bound at get_uniform_buffer_offset()
+  const uint32_t slot_count = info.benchmark_frames_in_flight > 0 ? info.benchmark_frames_in_flight : 1;
+  init_uniform_ring(info, info.uniform_data, sizeof(uniformData), slot_count);
+  for (uint32_t i = 0; i < slot_count; i++) write_uniform_ring(info, info.uniform_data, i, &uniformData);
 }
 
 void createFramebuffer(sample_info &info){
   VkResult U_ASSERT_ONLY res;
   bool U_ASSERT_ONLY pass;
 
-  float width = 512;
-  float height = 512;
+  float width = info.width;
+  float height = info.height;
 
   VkImageCreateInfo imageCreateInfo;
   imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -235,22 +234,14 @@ void createFramebuffer(sample_info &info){
   imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
   imageCreateInfo.flags = 0;
 
-  VkMemoryAllocateInfo allocInfo = {};
-  VkMemoryRequirements memReqs;
-
   info.buffers.resize(1);
   info.swapchainImageCount = 1;
   res = vkCreateImage(info.device, &imageCreateInfo, NULL, &(info.buffers[0].image));
   assert(res == VK_SUCCESS);
 
-  vkGetImageMemoryRequirements(info.device, info.buffers[0].image, &memReqs);
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.pNext = NULL;
-  allocInfo.allocationSize = memReqs.size;
-  pass = memory_type_from_properties(info, memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &allocInfo.memoryTypeIndex);
+  pass = device_alloc_image(info, info.buffers[0].image, imageCreateInfo.tiling, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                            info.buffers[0].mem);
   assert(pass && "No device local memory");
-  vkAllocateMemory(info.device, &allocInfo, NULL, &(info.buffers[0].mem));
-  vkBindImageMemory(info.device, info.buffers[0].image, info.buffers[0].mem, 0);
 
   VkImageViewCreateInfo imageViewCreateInfo = {};
   imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -287,7 +278,7 @@ void createDescriptorAndPipelineLayout(sample_info &info){
 
   VkDescriptorSetLayoutBinding layout_bindings[1];
   layout_bindings[0].binding = 0;
-  layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
   layout_bindings[0].descriptorCount = 1;
   layout_bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
   layout_bindings[0].pImmutableSamplers = NULL;
@@ -322,7 +313,7 @@ void createDescriptorPoolAndSet(sample_info &info){
   VkResult U_ASSERT_ONLY res;
 
   VkDescriptorPoolSize type_count[1];
-  type_count[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  type_count[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
   type_count[0].descriptorCount = 1;
 
 
@@ -352,7 +343,7 @@ void createDescriptorPoolAndSet(sample_info &info){
   writes[0].pNext = NULL;
   writes[0].dstSet = info.desc_set[0];
   writes[0].descriptorCount = 1;
-  writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
   writes[0].pBufferInfo = &info.uniform_data.buffer_info;
   writes[0].dstArrayElement = 0;
   writes[0].dstBinding = 0;
@@ -365,16 +356,16 @@ void my_destroy_framebuffers(sample_info &info){
     vkDestroyFramebuffer(info.device, info.framebuffers[x], NULL);
     vkDestroyImage(info.device, info.buffers[x].image, NULL);
     vkDestroyImageView(info.device, info.buffers[x].view, NULL);
-    vkFreeMemory(info.device, info.buffers[x].mem, NULL);
+    device_free(info, info.buffers[x].mem);
   }
 }
 
 int sample_main(int argc, char *argv[]) {
-    VkResult U_ASSERT_ONLY res;
     struct sample_info info = {};
     char sample_title[] = "Vertex Buffer Sample";
     const bool depthPresent = false;
 
+    process_command_line_args(info, argc, argv);
     init_global_layer_properties(info);
     init_instance_extension_names(info);
     init_device_extension_names(info);
@@ -382,112 +373,51 @@ int sample_main(int argc, char *argv[]) {
     init_enumerate_device(info);
     init_device(info);
     init_command_pool(info);
-    init_command_buffer(info);
-    execute_begin_command_buffer(info);
+    init_command_buffer(info);        // Primary command buffer to hold secondaries
+    init_command_buffer_array(info);  // Array of primary command buffers
+    init_command_buffer2_array(info); // Array containing all secondary buffers
     init_device_queue(info);
     info.format = VK_FORMAT_R8G8B8A8_UNORM; //Needed since we do not call init_window which sets the renderpass format
+    info.width = 512;
+    info.height = 512;
     init_renderpass(info, depthPresent);
     // Custom code for benchmark
     createVertexBuffer(info);
+    createIndexBuffer(info); // For the indexed variants of the indirect benchmark
     createUniformBuffer(info);
     createFramebuffer(info);
     createDescriptorAndPipelineLayout(info);
     createDescriptorPoolAndSet(info);
     // Custom code end for benchmark
     init_shaders(info, vertShaderText, fragShaderText);
+    init_push_constant_shader(info, pushConstantVertShaderText); // For the push_constants benchmark variant
     init_pipeline_cache(info);
     init_pipeline(info, false, true);
-    // Begin renderpass
 
     VkClearValue clear_values[2];
     clear_values[0].color.float32[0] = 0.2f;
     clear_values[0].color.float32[1] = 0.2f;
     clear_values[0].color.float32[2] = 0.2f;
     clear_values[0].color.float32[3] = 0.2f;
+    clear_values[1].depthStencil.depth = 1.0f;
+    clear_values[1].depthStencil.stencil = 0;
 
-    VkRenderPassBeginInfo rp_begin;
-    rp_begin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    rp_begin.pNext = NULL;
-    rp_begin.renderPass = info.render_pass;
-    rp_begin.framebuffer = info.framebuffers[0];
-    rp_begin.renderArea.offset.x = 0;
-    rp_begin.renderArea.offset.y = 0;
-    rp_begin.renderArea.extent.width = 512;
-    rp_begin.renderArea.extent.height = 512;
-    rp_begin.clearValueCount = 1;
-    rp_begin.pClearValues = clear_values;
-
-    vkCmdBeginRenderPass(info.cmd, &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(info.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, info.pipeline);
-    vkCmdBindDescriptorSets(info.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            info.pipeline_layout, 0, 1, info.desc_set.data(), 0, NULL);
-    const VkDeviceSize offsets[1] = {0};
-    vkCmdBindVertexBuffers(info.cmd, 0, 1, &info.vertex_buffer.buf, offsets);
-
-#ifdef __ANDROID__
-    // Some drivers don't like setting viewport and scissor
-#else
-    info.viewport.height = 512.0f;
-    info.viewport.width = 512.0f;
-    info.viewport.minDepth = 0.0f;
-    info.viewport.maxDepth = 1.0f;
-    info.viewport.x = 0;
-    info.viewport.y = 0;
-    vkCmdSetViewport(info.cmd, 0, 1, &info.viewport);
-
-    info.scissor.extent.width = info.width;
-    info.scissor.extent.height = info.height;
-    info.scissor.offset.x = 0;
-    info.scissor.offset.y = 0;
-    vkCmdSetScissor(info.cmd, 0, NUM_SCISSORS, &info.scissor);
-#endif
-
-    vkCmdDraw(info.cmd, 3, 1, 0, 0);
-    vkCmdEndRenderPass(info.cmd);
-    res = vkEndCommandBuffer(info.cmd);
-    assert(res == VK_SUCCESS);
-
-    const VkCommandBuffer cmd_bufs[] = {info.cmd};
-    VkFenceCreateInfo fenceInfo;
-    VkFence drawFence;
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.pNext = NULL;
-    fenceInfo.flags = 0;
-    vkCreateFence(info.device, &fenceInfo, NULL, &drawFence);
-
-    VkPipelineStageFlags pipe_stage_flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    VkSubmitInfo submit_info[1] = {};
-    submit_info[0].pNext = NULL;
-    submit_info[0].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit_info[0].waitSemaphoreCount = 0;
-    submit_info[0].pWaitSemaphores = NULL;
-    submit_info[0].pWaitDstStageMask = &pipe_stage_flags;
-    submit_info[0].commandBufferCount = 1;
-    submit_info[0].pCommandBuffers = cmd_bufs;
-    submit_info[0].signalSemaphoreCount = 0;
-    submit_info[0].pSignalSemaphores = NULL;
-
-    res = vkQueueSubmit(info.graphics_queue, 1, submit_info, drawFence);
-    assert(res == VK_SUCCESS);
-
-        /* Make sure command buffer is finished before presenting */
-    do {
-        res = vkWaitForFences(info.device, 1, &drawFence, VK_TRUE, FENCE_TIMEOUT);
-    } while (res == VK_TIMEOUT);
-    // End Render Pass
-
+    // Offscreen framebuffer, so there is no swapchain image to acquire
+    execute_benchmarks(info, "13-init_vertex_buffer", "primary_single", clear_values);
 
     // Clean up time
-    vkDestroyFence(info.device, drawFence, NULL);
     destroy_pipeline(info);
     destroy_pipeline_cache(info);
     destroy_descriptor_pool(info);
     my_destroy_framebuffers(info); //Using the swapchain container for offscreen framebuffer
     destroy_uniform_buffer(info);
+    destroy_index_buffer(info);
     destroy_vertex_buffer(info);
     destroy_descriptor_and_pipeline_layouts(info);
     destroy_shaders(info);
     destroy_renderpass(info);
+    destroy_command_buffer2_array(info);
+    destroy_command_buffer_array(info);
     destroy_command_buffer(info);
     destroy_command_pool(info);
     destroy_device(info);
@@ -0,0 +1,174 @@
+/*
+ * Vulkan Samples
+ *
+ * Copyright (C) 2015-2016 Valve Corporation
+ * Copyright (C) 2015-2016 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+VULKAN_SAMPLE_SHORT_DESCRIPTION
+Draw Instanced Cubes
+*/
+
+/* This is part of the draw cube progression */
+
+#include <util_init.hpp>
+#include <assert.h>
+#include <string.h>
+#include <cmath>
+#include <cstdlib>
+#include "cube_data.h"
+#include "draw_benchmarks.hpp"
+
+/* For this sample, we'll start with GLSL so the shader function is plain */
+/* and then use the glslang GLSLtoSPV utility to convert it to SPIR-V for */
+/* the driver.  We do this for clarity rather than using pre-compiled     */
+/* SPIR-V                                                                 */
+
+/* Same as draw_cube, with each instance's transform read from binding 1 */
+static const char *vertShaderText =
+    "#version 400\n"
+    "#extension GL_ARB_separate_shader_objects : enable\n"
+    "#extension GL_ARB_shading_language_420pack : enable\n"
+    "layout (std140, binding = 0) uniform bufferVals {\n"
+    "    mat4 mvp;\n"
+    "} myBufferVals;\n"
+    "layout (location = 0) in vec4 pos;\n"
+    "layout (location = 1) in vec4 inColor;\n"
+    "layout (location = 2) in mat4 instanceTransform;\n"
+    "layout (location = 0) out vec4 outColor;\n"
+    "void main() {\n"
+    "   outColor = inColor;\n"
+    "   gl_Position = myBufferVals.mvp * instanceTransform * pos;\n"
+    "}\n";
+
+/* The same shader reading the MVP from push constants */
+static const char *pushConstantVertShaderText =
+    "#version 400\n"
+    "#extension GL_ARB_separate_shader_objects : enable\n"
+    "#extension GL_ARB_shading_language_420pack : enable\n"
+    "layout (push_constant) uniform pushVals {\n"
+    "    mat4 mvp;\n"
+    "} myPushVals;\n"
+    "layout (location = 0) in vec4 pos;\n"
+    "layout (location = 1) in vec4 inColor;\n"
+    "layout (location = 2) in mat4 instanceTransform;\n"
+    "layout (location = 0) out vec4 outColor;\n"
+    "void main() {\n"
+    "   outColor = inColor;\n"
+    "   gl_Position = myPushVals.mvp * instanceTransform * pos;\n"
+    "}\n";
+
+static const char *fragShaderText =
+    "#version 400\n"
+    "#extension GL_ARB_separate_shader_objects : enable\n"
+    "#extension GL_ARB_shading_language_420pack : enable\n"
+    "layout (location = 0) in vec4 color;\n"
+    "layout (location = 0) out vec4 outColor;\n"
+    "void main() {\n"
+    "   outColor = color;\n"
+    "}\n";
+
+/*
+ * One cube per benchmark draw, shrunk onto a square grid in the space the
+ * single cube of draw_cube takes up
+ */
+static std::vector<glm::mat4> init_instance_transforms(uint32_t count) {
+    std::vector<glm::mat4> transforms(count);
+    uint32_t side = (uint32_t)ceil(sqrt((double)count));
+    float spacing = 4.0f / side;
+    for (uint32_t i = 0; i < count; i++) {
+        glm::vec3 offset(-2.0f + spacing * (i % side + 0.5f), -2.0f + spacing * (i / side + 0.5f), 0.0f);
+        transforms[i] = glm::scale(glm::translate(glm::mat4(1.0f), offset), glm::vec3(spacing * 0.4f));
+    }
+    return transforms;
+}
+
+int sample_main(int argc, char *argv[]) {
+    struct sample_info info = {};
+    char sample_title[] = "Draw Instanced Cubes";
+    const bool depthPresent = true;
+
+    process_command_line_args(info, argc, argv);
+    init_global_layer_properties(info);
+    init_instance_extension_names(info);
+    init_device_extension_names(info);
+    init_instance(info, sample_title);
+    init_enumerate_device(info);
+    init_window_size(info, 500, 500);
+    init_connection(info);
+    init_window(info);
+    init_swapchain_extension(info);
+    init_device(info);
+
+    init_command_pool(info);
+    init_command_buffer(info);        // Primary command buffer to hold secondaries
+    init_command_buffer_array(info);  // Array of primary command buffers
+    init_command_buffer2_array(info); // Array containing all secondary buffers
+    init_device_queue(info);
+    init_swap_chain(info);
+    init_depth_buffer(info);
+    init_uniform_buffer(info);
+    init_descriptor_and_pipeline_layouts(info, false);
+    init_renderpass(info, depthPresent);
+    init_shaders(info, vertShaderText, fragShaderText);
+    init_push_constant_shader(info, pushConstantVertShaderText); // For the push_constants benchmark variant
+    init_framebuffers(info, depthPresent);
+    init_vertex_buffer(info, g_vb_solid_face_colors_Data, sizeof(g_vb_solid_face_colors_Data),
+                       sizeof(g_vb_solid_face_colors_Data[0]), false);
+    // --draws cubes, so the instanced scenario is comparable with the others
+    std::vector<glm::mat4> transforms = init_instance_transforms(info.benchmark_draws);
+    init_instance_buffer(info, transforms.data(), transforms.size());
+    init_descriptor_pool(info, false);
+    init_descriptor_set(info, false);
+    init_pipeline_cache(info);
+    init_pipeline(info, depthPresent);
+
+    /* VULKAN_KEY_START */
+
+    VkClearValue clear_values[2];
+    clear_values[0].color.float32[0] = 0.2f;
+    clear_values[0].color.float32[1] = 0.2f;
+    clear_values[0].color.float32[2] = 0.2f;
+    clear_values[0].color.float32[3] = 0.2f;
+    clear_values[1].depthStencil.depth = 1.0f;
+    clear_values[1].depthStencil.stencil = 0;
+
+    // Runs both variants of instanced unless another scenario was picked with --benchmark
+    execute_benchmarks(info, "draw_instanced_cube", "instanced", clear_values);
+    /* VULKAN_KEY_END */
+    if (info.save_images) write_ppm(info, "draw_instanced_cube");
+
+    destroy_pipeline(info);
+    destroy_pipeline_cache(info);
+    destroy_descriptor_pool(info);
+    destroy_instance_buffer(info);
+    destroy_vertex_buffer(info);
+    destroy_framebuffers(info);
+    destroy_shaders(info);
+    destroy_renderpass(info);
+    destroy_descriptor_and_pipeline_layouts(info);
+    destroy_uniform_buffer(info);
+    destroy_depth_buffer(info);
+    destroy_swap_chain(info);
+    destroy_command_buffer2_array(info);
+    destroy_command_buffer_array(info);
+    destroy_command_buffer(info);
+    destroy_command_pool(info);
+    destroy_device(info);
+    destroy_window(info);
+    destroy_instance(info);
+    return 0;
+}
@@ -29,8 +29,7 @@ Draw Textured Cube
 #include <string.h>
 #include <cstdlib>
 #include "cube_data.h"
-#include "draw_benchmarks.cpp"
-#include <chrono>  // for high_resolution_clock
+#include "draw_benchmarks.hpp"
 
 /* For this sample, we'll start with GLSL so the shader function is plain */
 /* and then use the glslang GLSLtoSPV utility to convert it to SPIR-V for */
@@ -52,6 +51,22 @@ const char *vertShaderText =
     "   gl_Position = ubuf.mvp * pos;\n"
     "}\n";
 
+/* The same shader reading the MVP from push constants */
+const char *pushConstantVertShaderText =
+    "#version 400\n"
+    "#extension GL_ARB_separate_shader_objects : enable\n"
+    "#extension GL_ARB_shading_language_420pack : enable\n"
+    "layout (push_constant) uniform pushVals {\n"
+    "        mat4 mvp;\n"
+    "} pushVals;\n"
+    "layout (location = 0) in vec4 pos;\n"
+    "layout (location = 1) in vec2 inTexCoords;\n"
+    "layout (location = 0) out vec2 texcoord;\n"
+    "void main() {\n"
+    "   texcoord = inTexCoords;\n"
+    "   gl_Position = pushVals.mvp * pos;\n"
+    "}\n";
+
 const char *fragShaderText =
     "#version 400\n"
     "#extension GL_ARB_separate_shader_objects : enable\n"
@@ -64,7 +79,6 @@ const char *fragShaderText =
     "}\n";
 
 int sample_main(int argc, char *argv[]) {
-    VkResult U_ASSERT_ONLY res;
     struct sample_info info = {};
     char sample_title[] = "Draw Textured Cube";
     const bool depthPresent = true;
@@ -94,6 +108,7 @@ int sample_main(int argc, char *argv[]) {
     init_descriptor_and_pipeline_layouts(info, true);
     init_renderpass(info, depthPresent);
     init_shaders(info, vertShaderText, fragShaderText);
+    init_push_constant_shader(info, pushConstantVertShaderText); // For the push_constants benchmark variant
     init_framebuffers(info, depthPresent);
     init_vertex_buffer(info, g_vb_texture_Data, sizeof(g_vb_texture_Data), sizeof(g_vb_texture_Data[0]), true);
     init_descriptor_pool(info, true);
@@ -112,54 +127,11 @@ int sample_main(int argc, char *argv[]) {
     clear_values[1].depthStencil.depth = 1.0f;
     clear_values[1].depthStencil.stencil = 0;
 
-    VkSemaphore imageAcquiredSemaphore;
-    VkSemaphoreCreateInfo imageAcquiredSemaphoreCreateInfo;
-    imageAcquiredSemaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-    imageAcquiredSemaphoreCreateInfo.pNext = NULL;
-    imageAcquiredSemaphoreCreateInfo.flags = 0;
-
-    res = vkCreateSemaphore(info.device, &imageAcquiredSemaphoreCreateInfo, NULL, &imageAcquiredSemaphore);
-    assert(res == VK_SUCCESS);
-
-    VkFenceCreateInfo fenceInfo;
-    VkFence drawFence;
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.pNext = NULL;
-    fenceInfo.flags = 0;
-    res = vkCreateFence(info.device, &fenceInfo, NULL, &drawFence);
-    assert(res == VK_SUCCESS);
-
-    int frames = 100;
-    auto start = std::chrono::high_resolution_clock::now();
-    for (int x = 0; x < frames; x++) {
-        info.current_buffer = x % info.swapchainImageCount;
-
-        // Get the index of the next available swapchain image:
-        res = vkAcquireNextImageKHR(info.device,
-                                    info.swap_chain,
-                                    UINT64_MAX,
-                                    imageAcquiredSemaphore,
-                                    VK_NULL_HANDLE,
-                                    &info.current_buffer);
-        // TODO: Deal with the VK_SUBOPTIMAL_KHR and VK_ERROR_OUT_OF_DATE_KHR
-        // return codes
-        assert(res == VK_SUCCESS);
-        primaryCommandBufferBenchmark2(info,
-                                        clear_values,
-                                        drawFence,
-                                        imageAcquiredSemaphore);
-    }
-    auto finish = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = finish - start;
-    std::cout << "Elapsed time: " << elapsed.count() << " s\n";
-#ifdef __ANDROID__
-    LOGE("Elapsed Time: %f", elapsed.count());
-#endif
+    // Runs primary_single unless another scenario was picked with --benchmark
+    execute_benchmarks(info, "draw_textured_cube", "primary_single", clear_values);
     /* VULKAN_KEY_END */
     if (info.save_images) write_ppm(info, "draw_textured_cube");
 
-    vkDestroySemaphore(info.device, imageAcquiredSemaphore, NULL);
-    vkDestroyFence(info.device, drawFence, NULL);
     destroy_pipeline(info);
     destroy_pipeline_cache(info);
     destroy_textures(info);
@@ -0,0 +1,136 @@
+/*
+VULKAN_SAMPLE_DESCRIPTION
+samples benchmark statistics helpers
+*/
+
+#include <math.h>
+#include "benchmark_stats.hpp"
+#include "benchmark_trace.hpp"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define HISTOGRAM_FULL_BUCKET (1u << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_HALF_BUCKET (1u << (HISTOGRAM_SUB_BUCKET_BITS - 1))
+#define HISTOGRAM_BUCKET_COUNT (HISTOGRAM_FULL_BUCKET + (64 - HISTOGRAM_SUB_BUCKET_BITS) * HISTOGRAM_HALF_BUCKET)
+
+static uint32_t highest_bit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    uint32_t index = 0;
+    while (value >>= 1) index++;
+    return index;
+#endif
+}
+
+static uint32_t histogram_index(uint64_t value) {
+    if (value < HISTOGRAM_FULL_BUCKET) return (uint32_t)value;
+    uint32_t shift = highest_bit(value) - (HISTOGRAM_SUB_BUCKET_BITS - 1);
+    uint32_t sub = (uint32_t)(value >> shift) - HISTOGRAM_HALF_BUCKET;
+    return HISTOGRAM_FULL_BUCKET + (shift - 1) * HISTOGRAM_HALF_BUCKET + sub;
+}
+
+/* Midpoint of the range of values counted in bucket index */
+static uint64_t histogram_value(uint32_t index) {
+    if (index < HISTOGRAM_FULL_BUCKET) return index;
+    uint32_t j = index - HISTOGRAM_FULL_BUCKET;
+    uint32_t shift = j / HISTOGRAM_HALF_BUCKET + 1;
+    uint64_t low = (uint64_t)(j % HISTOGRAM_HALF_BUCKET + HISTOGRAM_HALF_BUCKET) << shift;
+    return low + ((1ull << shift) >> 1);
+}
+
+void init_latency_histogram(latency_histogram &hist) {
+    hist.counts.assign(HISTOGRAM_BUCKET_COUNT, 0);
+    hist.count = 0;
+    hist.min = UINT64_MAX;
+    hist.max = 0;
+    hist.sum = 0.0;
+    hist.sum_sq = 0.0;
+}
+
+void reset_latency_histogram(latency_histogram &hist) { init_latency_histogram(hist); }
+
+void latency_histogram_record(latency_histogram &hist, uint64_t value_ns) {
+    hist.counts[histogram_index(value_ns)]++;
+    hist.count++;
+    if (value_ns < hist.min) hist.min = value_ns;
+    if (value_ns > hist.max) hist.max = value_ns;
+    hist.sum += (double)value_ns;
+    hist.sum_sq += (double)value_ns * (double)value_ns;
+}
+
+uint64_t latency_histogram_percentile(const latency_histogram &hist, double percentile) {
+    if (hist.count == 0) return 0;
+
+    uint64_t target = (uint64_t)ceil(percentile / 100.0 * (double)hist.count);
+    if (target < 1) target = 1;
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < hist.counts.size(); i++) {
+        seen += hist.counts[i];
+        if (seen >= target) {
+            uint64_t value = histogram_value(i);
+            // The exact extremes are known, never report past them
+            if (value < hist.min) value = hist.min;
+            if (value > hist.max) value = hist.max;
+            return value;
+        }
+    }
+    return hist.max;
+}
+
+double latency_histogram_mean(const latency_histogram &hist) { return hist.count ? hist.sum / (double)hist.count : 0.0; }
+
+double latency_histogram_stddev(const latency_histogram &hist) {
+    if (hist.count < 2) return 0.0;
+    double mean = latency_histogram_mean(hist);
+    double variance = (hist.sum_sq - hist.sum * mean) / (double)(hist.count - 1);
+    return variance > 0.0 ? sqrt(variance) : 0.0;
+}
+
+void append_latency_metrics(const latency_histogram &hist, const char *prefix, benchmark_metrics &metrics) {
+    const double ns_to_ms = 1.0 / 1000000.0;
+    std::string name(prefix);
+
+    metrics.push_back(std::make_pair(name + "_min_ms", (hist.count ? hist.min : 0) * ns_to_ms));
+    metrics.push_back(std::make_pair(name + "_mean_ms", latency_histogram_mean(hist) * ns_to_ms));
+    metrics.push_back(std::make_pair(name + "_p50_ms", latency_histogram_percentile(hist, 50.0) * ns_to_ms));
+    metrics.push_back(std::make_pair(name + "_p90_ms", latency_histogram_percentile(hist, 90.0) * ns_to_ms));
+    metrics.push_back(std::make_pair(name + "_p99_ms", latency_histogram_percentile(hist, 99.0) * ns_to_ms));
+    metrics.push_back(std::make_pair(name + "_p99_9_ms", latency_histogram_percentile(hist, 99.9) * ns_to_ms));
+    metrics.push_back(std::make_pair(name + "_max_ms", hist.max * ns_to_ms));
+    metrics.push_back(std::make_pair(name + "_stddev_ms", latency_histogram_stddev(hist) * ns_to_ms));
+}
+
+static const char *const benchmark_phase_names[BENCHMARK_PHASE_COUNT] = {
+    "phase_acquire", "phase_record", "phase_submit", "phase_wait", "phase_present",
+};
+static latency_histogram benchmark_phase_times[BENCHMARK_PHASE_COUNT];
+static bool benchmark_phases_recording = false;
+
+void start_benchmark_phases() {
+    for (uint32_t i = 0; i < BENCHMARK_PHASE_COUNT; i++) init_latency_histogram(benchmark_phase_times[i]);
+    benchmark_phases_recording = true;
+}
+
+void stop_benchmark_phases() { benchmark_phases_recording = false; }
+
+bool benchmark_phases_active() { return benchmark_phases_recording; }
+
+void record_benchmark_phase(benchmark_phase phase, uint64_t begin_ns, uint64_t end_ns) {
+    if (benchmark_phases_recording) latency_histogram_record(benchmark_phase_times[phase], end_ns - begin_ns);
+    trace_event_record("phase", benchmark_phase_names[phase], begin_ns, end_ns);
+}
+
+void append_benchmark_phase_metrics(benchmark_metrics &metrics) {
+    for (uint32_t i = 0; i < BENCHMARK_PHASE_COUNT; i++) {
+        // Phases a scenario never enters (e.g. present when headless) are left out
+        if (benchmark_phase_times[i].count) append_latency_metrics(benchmark_phase_times[i], benchmark_phase_names[i], metrics);
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef BENCHMARK_STATS
+#define BENCHMARK_STATS
+
+#include <stdint.h>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Values below 2^HISTOGRAM_SUB_BUCKET_BITS are counted exactly, larger ones in
+ * 2^(HISTOGRAM_SUB_BUCKET_BITS - 1) linear sub-buckets per power of two, so a
+ * reported percentile is within 1/64 of the recorded value.
+ */
+#define HISTOGRAM_SUB_BUCKET_BITS 7
+
+typedef std::vector<std::pair<std::string, double> > benchmark_metrics;
+
+/*
+ * Log-linear (HDR style) histogram of nanosecond durations.  Recording is a
+ * bit scan and an increment, so it can sit inside the timed frame loop.
+ */
+struct latency_histogram {
+    std::vector<uint64_t> counts;
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+    double sum_sq;
+};
+
+void init_latency_histogram(latency_histogram &hist);
+void reset_latency_histogram(latency_histogram &hist);
+void latency_histogram_record(latency_histogram &hist, uint64_t value_ns);
+uint64_t latency_histogram_percentile(const latency_histogram &hist, double percentile);
+double latency_histogram_mean(const latency_histogram &hist);
+double latency_histogram_stddev(const latency_histogram &hist);
+
+/*
+ * Appends <prefix>_{min,mean,p50,p90,p99,p99_9,max,stddev}_ms to metrics
+ */
+void append_latency_metrics(const latency_histogram &hist, const char *prefix, benchmark_metrics &metrics);
+
+/*
+ * CPU phases of a benchmark frame.  The BENCHMARK_PHASE_BEGIN/END macros
+ * around each phase compile to nothing unless BENCHMARK_PHASE_TIMING is
+ * defined (the SAMPLES_BENCHMARK_PHASE_TIMING cmake option).  They must only
+ * be used from the thread running the benchmark loop.
+ */
+enum benchmark_phase {
+    BENCHMARK_PHASE_ACQUIRE,
+    BENCHMARK_PHASE_RECORD,
+    BENCHMARK_PHASE_SUBMIT,
+    BENCHMARK_PHASE_WAIT,
+    BENCHMARK_PHASE_PRESENT,
+    BENCHMARK_PHASE_COUNT
+};
+
+static inline uint64_t benchmark_timestamp_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+
+#ifdef BENCHMARK_PHASE_TIMING
+#define BENCHMARK_PHASE_BEGIN(phase) const uint64_t phase##_begin_ns = benchmark_timestamp_ns()
+#define BENCHMARK_PHASE_END(phase) record_benchmark_phase(phase, phase##_begin_ns, benchmark_timestamp_ns())
+#else
+#define BENCHMARK_PHASE_BEGIN(phase)
+#define BENCHMARK_PHASE_END(phase)
+#endif
+
+/*
+ * Phase durations are only kept between start_benchmark_phases() and
+ * stop_benchmark_phases(), so warmup frames are left out.  While tracing
+ * every phase, warmup included, also goes into the trace.
+ */
+void start_benchmark_phases();
+void stop_benchmark_phases();
+bool benchmark_phases_active();
+void record_benchmark_phase(benchmark_phase phase, uint64_t begin_ns, uint64_t end_ns);
+void append_benchmark_phase_metrics(benchmark_metrics &metrics);
+
+#endif // BENCHMARK_STATS
@@ -0,0 +1,219 @@
+/*
+VULKAN_SAMPLE_DESCRIPTION
+samples benchmark recording threads
+*/
+
+#include <assert.h>
+#include <thread>
+#include "benchmark_threads.hpp"
+#include "benchmark_trace.hpp"
+
+uint32_t get_benchmark_core_count() {
+    uint32_t count = std::thread::hardware_concurrency();
+    return count ? count : 1;
+}
+
+static bool take_chunk(benchmark_worker &worker, uint32_t &chunk) {
+    bool found = false;
+    sample_platform_thread_lock_mutex(&worker.chunk_mutex);
+    if (worker.chunk_head < worker.chunk_tail) {
+        chunk = worker.chunk_head++;
+        found = true;
+    }
+    sample_platform_thread_unlock_mutex(&worker.chunk_mutex);
+    return found;
+}
+
+static bool steal_chunk(benchmark_worker &worker, uint32_t &chunk) {
+    std::vector<benchmark_worker> &workers = worker.pool->workers;
+    for (uint32_t i = 1; i < workers.size(); i++) {
+        benchmark_worker &victim = workers[(worker.index + i) % workers.size()];
+        bool found = false;
+        sample_platform_thread_lock_mutex(&victim.chunk_mutex);
+        if (victim.chunk_head < victim.chunk_tail) {
+            chunk = --victim.chunk_tail;
+            found = true;
+        }
+        sample_platform_thread_unlock_mutex(&victim.chunk_mutex);
+        if (found) {
+            worker.steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void run_benchmark_worker(benchmark_worker &worker) {
+    benchmark_worker_pool &pool = *worker.pool;
+    VkResult U_ASSERT_ONLY res;
+
+    // Everything recorded from this pool the last time round has completed
+    benchmark_worker_frame &frame = worker.frames[pool.frame];
+    res = vkResetCommandPool(pool.info->device, frame.cmd_pool, 0);
+    assert(res == VK_SUCCESS);
+    frame.cmd_bufs_used[VK_COMMAND_BUFFER_LEVEL_PRIMARY] = 0;
+    frame.cmd_bufs_used[VK_COMMAND_BUFFER_LEVEL_SECONDARY] = 0;
+
+    uint32_t chunk;
+    while (take_chunk(worker, chunk) || steal_chunk(worker, chunk)) {
+        TRACE_ZONE("worker", "record_chunk");
+        uint32_t first = chunk * BENCHMARK_CHUNK_SIZE;
+        uint32_t count = pool.item_count - first < BENCHMARK_CHUNK_SIZE ? pool.item_count - first : BENCHMARK_CHUNK_SIZE;
+        pool.record(*pool.info, worker, first, count, pool.data);
+    }
+}
+
+static void *benchmark_worker_thread(void *arg) {
+    benchmark_worker &worker = *(benchmark_worker *)arg;
+    benchmark_worker_pool &pool = *worker.pool;
+    uint64_t generation = 0;
+    set_trace_thread_name("benchmark worker " + std::to_string(worker.index));
+
+    for (;;) {
+        sample_platform_thread_lock_mutex(&pool.mutex);
+        while (!pool.quit && pool.generation == generation) sample_platform_thread_cond_wait(&pool.start_cond, &pool.mutex);
+        bool quit = pool.quit;
+        generation = pool.generation;
+        sample_platform_thread_unlock_mutex(&pool.mutex);
+        if (quit) break;
+
+        run_benchmark_worker(worker);
+
+        sample_platform_thread_lock_mutex(&pool.mutex);
+        if (--pool.busy == 0) sample_platform_thread_cond_broadcast(&pool.done_cond);
+        sample_platform_thread_unlock_mutex(&pool.mutex);
+    }
+    return NULL;
+}
+
+void init_benchmark_workers(sample_info &info, benchmark_worker_pool &pool, uint32_t thread_count, uint32_t frame_count) {
+    VkResult U_ASSERT_ONLY res;
+
+    pool.info = &info;
+    pool.generation = 0;
+    pool.busy = 0;
+    pool.quit = false;
+    pool.record = NULL;
+    pool.data = NULL;
+    pool.item_count = 0;
+    pool.frame = 0;
+    sample_platform_thread_create_mutex(&pool.mutex);
+    sample_platform_thread_init_cond(&pool.start_cond);
+    sample_platform_thread_init_cond(&pool.done_cond);
+
+    // Sized once, the threads keep pointers to their worker
+    pool.workers.resize(thread_count);
+    for (uint32_t i = 0; i < thread_count; i++) {
+        benchmark_worker &worker = pool.workers[i];
+        worker.pool = &pool;
+        worker.index = i;
+        worker.chunk_head = 0;
+        worker.chunk_tail = 0;
+        worker.steals = 0;
+        sample_platform_thread_create_mutex(&worker.chunk_mutex);
+
+        worker.frames.resize(frame_count);
+        for (uint32_t f = 0; f < frame_count; f++) {
+            benchmark_worker_frame &frame = worker.frames[f];
+            frame.cmd_bufs_used[VK_COMMAND_BUFFER_LEVEL_PRIMARY] = 0;
+            frame.cmd_bufs_used[VK_COMMAND_BUFFER_LEVEL_SECONDARY] = 0;
+
+            VkCommandPoolCreateInfo cmd_pool_info = {};
+            cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            cmd_pool_info.pNext = NULL;
+            cmd_pool_info.queueFamilyIndex = info.graphics_queue_family_index;
+            cmd_pool_info.flags = 0;
+
+            res = vkCreateCommandPool(info.device, &cmd_pool_info, NULL, &frame.cmd_pool);
+            assert(res == VK_SUCCESS);
+        }
+    }
+
+    for (uint32_t i = 1; i < thread_count; i++) {
+        int U_ASSERT_ONLY err = sample_platform_thread_create(&pool.workers[i].thread, benchmark_worker_thread, &pool.workers[i]);
+#ifdef _WIN32
+        assert(err != 0);
+#else
+        assert(err == 0);
+#endif
+    }
+}
+
+void execute_benchmark_workers(benchmark_worker_pool &pool, uint32_t frame, uint32_t item_count,
+                               benchmark_record_func record, void *data) {
+    uint32_t thread_count = pool.workers.size();
+    uint32_t chunk_count = (item_count + BENCHMARK_CHUNK_SIZE - 1) / BENCHMARK_CHUNK_SIZE;
+
+    pool.record = record;
+    pool.data = data;
+    pool.item_count = item_count;
+    pool.frame = frame;
+
+    // Contiguous runs of chunks to begin with, stealing evens out the rest
+    for (uint32_t i = 0; i < thread_count; i++) {
+        benchmark_worker &worker = pool.workers[i];
+        sample_platform_thread_lock_mutex(&worker.chunk_mutex);
+        worker.chunk_head = (uint32_t)((uint64_t)chunk_count * i / thread_count);
+        worker.chunk_tail = (uint32_t)((uint64_t)chunk_count * (i + 1) / thread_count);
+        sample_platform_thread_unlock_mutex(&worker.chunk_mutex);
+    }
+
+    sample_platform_thread_lock_mutex(&pool.mutex);
+    pool.busy = thread_count - 1;
+    pool.generation++;
+    sample_platform_thread_cond_broadcast(&pool.start_cond);
+    sample_platform_thread_unlock_mutex(&pool.mutex);
+
+    run_benchmark_worker(pool.workers[0]);
+
+    sample_platform_thread_lock_mutex(&pool.mutex);
+    while (pool.busy) sample_platform_thread_cond_wait(&pool.done_cond, &pool.mutex);
+    sample_platform_thread_unlock_mutex(&pool.mutex);
+}
+
+VkCommandBuffer get_benchmark_worker_command_buffer(benchmark_worker &worker, VkCommandBufferLevel level) {
+    benchmark_worker_frame &frame = worker.frames[worker.pool->frame];
+    std::vector<VkCommandBuffer> &cmd_bufs = frame.cmd_bufs[level];
+    uint32_t &used = frame.cmd_bufs_used[level];
+
+    if (used == cmd_bufs.size()) {
+        VkResult U_ASSERT_ONLY res;
+
+        VkCommandBufferAllocateInfo cmd = {};
+        cmd.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmd.pNext = NULL;
+        cmd.commandPool = frame.cmd_pool;
+        cmd.level = level;
+        cmd.commandBufferCount = BENCHMARK_CHUNK_SIZE;
+
+        cmd_bufs.resize(used + BENCHMARK_CHUNK_SIZE);
+        res = vkAllocateCommandBuffers(worker.pool->info->device, &cmd, &cmd_bufs[used]);
+        assert(res == VK_SUCCESS);
+    }
+    return cmd_bufs[used++];
+}
+
+uint32_t get_benchmark_worker_steals(const benchmark_worker_pool &pool) {
+    uint32_t steals = 0;
+    for (uint32_t i = 0; i < pool.workers.size(); i++) steals += pool.workers[i].steals;
+    return steals;
+}
+
+void destroy_benchmark_workers(benchmark_worker_pool &pool) {
+    sample_platform_thread_lock_mutex(&pool.mutex);
+    pool.quit = true;
+    sample_platform_thread_cond_broadcast(&pool.start_cond);
+    sample_platform_thread_unlock_mutex(&pool.mutex);
+
+    for (uint32_t i = 0; i < pool.workers.size(); i++) {
+        benchmark_worker &worker = pool.workers[i];
+        if (i > 0) sample_platform_thread_join(worker.thread, NULL);
+        // Command buffers are freed along with their pool
+        for (uint32_t f = 0; f < worker.frames.size(); f++) {
+            vkDestroyCommandPool(pool.info->device, worker.frames[f].cmd_pool, NULL);
+        }
+        sample_platform_thread_delete_mutex(&worker.chunk_mutex);
+    }
+    pool.workers.clear();
+    sample_platform_thread_delete_mutex(&pool.mutex);
+}
@@ -0,0 +1,92 @@
+#ifndef BENCHMARK_THREADS
+#define BENCHMARK_THREADS
+
+#include <vector>
+#include "util.hpp"
+#include "samples_platform.h"
+
+/* Number of items a worker takes from a queue at a time */
+#define BENCHMARK_CHUNK_SIZE 64
+
+struct benchmark_worker_pool;
+
+/*
+ * A worker's command pool for one frame in flight
+ */
+struct benchmark_worker_frame {
+    VkCommandPool cmd_pool;
+    std::vector<VkCommandBuffer> cmd_bufs[2]; // Indexed by VkCommandBufferLevel
+    uint32_t cmd_bufs_used[2];
+};
+
+/*
+ * Recording state of one thread.  Command buffers only ever come from the
+ * worker's own pools, so no VkCommandPool is used by two threads at once.
+ */
+struct benchmark_worker {
+    benchmark_worker_pool *pool;
+    uint32_t index;
+    sample_platform_thread thread;
+
+    std::vector<benchmark_worker_frame> frames;
+
+    /* Chunks [chunk_head, chunk_tail) are still queued on this worker.  The  */
+    /* owner takes from the head and other workers steal from the tail.       */
+    sample_platform_thread_mutex chunk_mutex;
+    uint32_t chunk_head;
+    uint32_t chunk_tail;
+    uint32_t steals;
+};
+
+/*
+ * Records items [first, first + count) of a frame on the calling worker
+ */
+typedef void (*benchmark_record_func)(sample_info &info, benchmark_worker &worker, uint32_t first, uint32_t count,
+                                      void *data);
+
+/*
+ * Worker 0 is the thread calling execute_benchmark_workers(), the others
+ * sleep between frames.
+ */
+struct benchmark_worker_pool {
+    sample_info *info;
+    std::vector<benchmark_worker> workers;
+
+    sample_platform_thread_mutex mutex;
+    sample_platform_thread_cond start_cond;
+    sample_platform_thread_cond done_cond;
+    uint64_t generation;
+    uint32_t busy;
+    bool quit;
+
+    benchmark_record_func record;
+    void *data;
+    uint32_t item_count;
+    uint32_t frame; // Frame in flight being recorded
+};
+
+uint32_t get_benchmark_core_count();
+
+void init_benchmark_workers(sample_info &info, benchmark_worker_pool &pool, uint32_t thread_count, uint32_t frame_count);
+
+/*
+ * Resets every worker's command pool for frame, which must no longer be in
+ * use by the GPU, then records item_count items split into
+ * BENCHMARK_CHUNK_SIZE chunks across all workers and returns once they are
+ * all recorded.
+ */
+void execute_benchmark_workers(benchmark_worker_pool &pool, uint32_t frame, uint32_t item_count,
+                               benchmark_record_func record, void *data);
+
+/*
+ * Next command buffer of the given level from the worker's pool for the
+ * frame being recorded, allocated on first use.  Only valid until that
+ * frame is recorded again.
+ */
+VkCommandBuffer get_benchmark_worker_command_buffer(benchmark_worker &worker, VkCommandBufferLevel level);
+
+uint32_t get_benchmark_worker_steals(const benchmark_worker_pool &pool);
+
+void destroy_benchmark_workers(benchmark_worker_pool &pool);
+
+#endif // BENCHMARK_THREADS
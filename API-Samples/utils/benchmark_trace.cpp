@@ -0,0 +1,117 @@
+/*
+VULKAN_SAMPLE_DESCRIPTION
+samples Chrome trace event recording
+*/
+
+#include <stdio.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "benchmark_trace.hpp"
+
+struct trace_event {
+    const char *category;
+    const char *name;
+    uint64_t begin_ns;
+    uint64_t end_ns;
+};
+
+/*
+ * Only the owning thread writes a ring.  head counts every event it ever
+ * recorded and is published after the event, so write_trace() reads the
+ * last TRACE_RING_EVENTS of them.
+ */
+struct trace_ring {
+    uint32_t tid;
+    std::string thread_name;
+    std::atomic<uint64_t> head;
+    trace_event events[TRACE_RING_EVENTS];
+};
+
+static std::atomic<bool> trace_recording(false);
+static std::string trace_path;
+static uint64_t trace_start_ns = 0;
+
+// Rings stay allocated until exit, threads that have finished keep their events
+static std::mutex trace_rings_mutex;
+static std::vector<trace_ring *> trace_rings;
+static thread_local trace_ring *current_trace_ring = NULL;
+
+static trace_ring *get_trace_ring() {
+    if (current_trace_ring) return current_trace_ring;
+
+    trace_ring *ring = new trace_ring();
+    std::lock_guard<std::mutex> lock(trace_rings_mutex);
+    ring->tid = (uint32_t)trace_rings.size();
+    trace_rings.push_back(ring);
+    current_trace_ring = ring;
+    return ring;
+}
+
+void start_trace(const char *path) {
+    trace_path = path;
+    trace_start_ns = benchmark_timestamp_ns();
+    trace_recording.store(true, std::memory_order_release);
+    set_trace_thread_name("main");
+}
+
+bool trace_active() { return trace_recording.load(std::memory_order_relaxed); }
+
+void trace_event_record(const char *category, const char *name, uint64_t begin_ns, uint64_t end_ns) {
+    if (!trace_active()) return;
+    trace_ring *ring = get_trace_ring();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    trace_event &event = ring->events[head % TRACE_RING_EVENTS];
+    event.category = category;
+    event.name = name;
+    event.begin_ns = begin_ns;
+    event.end_ns = end_ns;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void set_trace_thread_name(const std::string &name) {
+    if (!trace_active()) return;
+    trace_ring *ring = get_trace_ring();
+    std::lock_guard<std::mutex> lock(trace_rings_mutex);
+    ring->thread_name = name;
+}
+
+void write_trace() {
+    if (!trace_active()) return;
+    trace_recording.store(false, std::memory_order_release);
+
+    FILE *out = fopen(trace_path.c_str(), "w");
+    if (!out) {
+        printf("\nCould not open trace file %s\n", trace_path.c_str());
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(trace_rings_mutex);
+    uint64_t dropped = 0;
+    bool first = true;
+    fprintf(out, "{\"traceEvents\":[\n");
+    for (size_t i = 0; i < trace_rings.size(); i++) {
+        trace_ring *ring = trace_rings[i];
+        if (!ring->thread_name.empty()) {
+            fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",\n", ring->tid, ring->thread_name.c_str());
+            first = false;
+        }
+
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t tail = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+        dropped += tail;
+        for (uint64_t e = tail; e < head; e++) {
+            const trace_event &event = ring->events[e % TRACE_RING_EVENTS];
+            // Timestamps are in microseconds, relative to start_trace()
+            fprintf(out, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                    first ? "" : ",\n", event.name, event.category, (double)(int64_t)(event.begin_ns - trace_start_ns) / 1e3,
+                    (double)(event.end_ns - event.begin_ns) / 1e3, ring->tid);
+            first = false;
+        }
+    }
+    fprintf(out, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":\"%llu\"}}\n", (unsigned long long)dropped);
+    fclose(out);
+
+    if (dropped) printf("\nTrace %s dropped the %llu oldest events\n", trace_path.c_str(), (unsigned long long)dropped);
+}
@@ -0,0 +1,66 @@
+#ifndef BENCHMARK_TRACE
+#define BENCHMARK_TRACE
+
+#include <stdint.h>
+#include <string>
+#include "benchmark_stats.hpp"
+
+/*
+ * Events kept per thread.  Once a thread's ring is full its oldest events
+ * are overwritten, and the trace reports how many were dropped.
+ */
+#define TRACE_RING_EVENTS 32768
+
+/*
+ * Timeline of what each thread was doing, written in the Chrome trace event
+ * format so a run opens in chrome://tracing or Perfetto.  Every thread
+ * records into a ring of its own, so recording takes no lock and is a few
+ * stores.  The TRACE_ZONE macro compiles to nothing unless SAMPLES_TRACE is
+ * defined (the SAMPLES_TRACE cmake option), and records nothing until
+ * start_trace() (--trace=<file>) is called.
+ */
+void start_trace(const char *path);
+bool trace_active();
+
+/*
+ * Names are not copied, so they must outlive the trace (string literals or
+ * __func__)
+ */
+void trace_event_record(const char *category, const char *name, uint64_t begin_ns, uint64_t end_ns);
+
+/*
+ * Names the calling thread's track in the trace viewer
+ */
+void set_trace_thread_name(const std::string &name);
+
+/*
+ * Writes every thread's events to the file given to start_trace() and stops
+ * tracing.  Threads must no longer be recording.
+ */
+void write_trace();
+
+/*
+ * Records the enclosing scope as one event
+ */
+struct trace_zone {
+    const char *category;
+    const char *name;
+    uint64_t begin_ns;
+
+    trace_zone(const char *category, const char *name)
+        : category(category), name(name), begin_ns(trace_active() ? benchmark_timestamp_ns() : 0) {}
+    ~trace_zone() {
+        if (begin_ns) trace_event_record(category, name, begin_ns, benchmark_timestamp_ns());
+    }
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef SAMPLES_TRACE
+#define TRACE_ZONE(category, name) trace_zone TRACE_CONCAT(trace_zone_, __LINE__)(category, name)
+#else
+#define TRACE_ZONE(category, name)
+#endif
+
+#endif // BENCHMARK_TRACE
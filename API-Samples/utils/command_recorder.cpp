@@ -0,0 +1,124 @@
+/*
+VULKAN_SAMPLE_DESCRIPTION
+samples command recorder filtering redundant state
+*/
+
+#include <string.h>
+#include "command_recorder.hpp"
+
+void init_command_recorder(command_recorder &rec, VkCommandBuffer cmd, bool track) {
+    rec.cmd = cmd;
+    rec.track = track;
+    rec.pipeline = VK_NULL_HANDLE;
+    for (uint32_t i = 0; i < COMMAND_RECORDER_MAX_SETS; i++) {
+        rec.set_layouts[i] = VK_NULL_HANDLE;
+        rec.sets[i] = VK_NULL_HANDLE;
+        rec.dynamic_offset_counts[i] = 0;
+    }
+    for (uint32_t i = 0; i < COMMAND_RECORDER_MAX_VERTEX_BINDINGS; i++) {
+        rec.vertex_buffers[i] = VK_NULL_HANDLE;
+        rec.vertex_offsets[i] = 0;
+    }
+    rec.viewport_valid = false;
+    rec.scissor_valid = false;
+    rec.issued = 0;
+    rec.filtered = 0;
+}
+
+void recorder_bind_pipeline(command_recorder &rec, VkPipeline pipeline) {
+    if (rec.track && pipeline == rec.pipeline) {
+        rec.filtered++;
+        return;
+    }
+    vkCmdBindPipeline(rec.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    rec.issued++;
+    rec.pipeline = pipeline;
+
+    // A pipeline with static viewport or scissor state leaves the dynamic state undefined
+    rec.viewport_valid = false;
+    rec.scissor_valid = false;
+}
+
+void recorder_bind_descriptor_sets(command_recorder &rec, VkPipelineLayout layout, uint32_t first_set,
+                                   uint32_t set_count, const VkDescriptorSet *sets, uint32_t dynamic_offset_count,
+                                   const uint32_t *dynamic_offsets) {
+    // Every dynamic offset belongs to the set when only one is bound
+    const bool trackable = first_set + set_count <= COMMAND_RECORDER_MAX_SETS &&
+                           (dynamic_offset_count == 0 ||
+                            (set_count == 1 && dynamic_offset_count <= COMMAND_RECORDER_MAX_DYNAMIC_OFFSETS));
+    bool redundant = rec.track && trackable;
+    for (uint32_t i = 0; redundant && i < set_count; i++) {
+        redundant = rec.sets[first_set + i] == sets[i] && rec.set_layouts[first_set + i] == layout &&
+                    rec.dynamic_offset_counts[first_set + i] == dynamic_offset_count &&
+                    (dynamic_offset_count == 0 || memcmp(rec.dynamic_offsets[first_set + i], dynamic_offsets,
+                                                         dynamic_offset_count * sizeof(uint32_t)) == 0);
+    }
+    if (redundant) {
+        rec.filtered++;
+        return;
+    }
+    vkCmdBindDescriptorSets(rec.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, first_set, set_count, sets,
+                            dynamic_offset_count, dynamic_offsets);
+    rec.issued++;
+
+    // Sets bound with another layout may be disturbed, so only trust the ones just bound
+    for (uint32_t i = 0; i < COMMAND_RECORDER_MAX_SETS; i++) {
+        bool bound = i >= first_set && i < first_set + set_count;
+        if (bound && trackable) {
+            rec.sets[i] = sets[i - first_set];
+            rec.set_layouts[i] = layout;
+            rec.dynamic_offset_counts[i] = dynamic_offset_count;
+            if (dynamic_offset_count) {
+                memcpy(rec.dynamic_offsets[i], dynamic_offsets, dynamic_offset_count * sizeof(uint32_t));
+            }
+        } else if (bound || rec.set_layouts[i] != layout) {
+            rec.sets[i] = VK_NULL_HANDLE;
+            rec.set_layouts[i] = VK_NULL_HANDLE;
+        }
+    }
+}
+
+void recorder_bind_vertex_buffers(command_recorder &rec, uint32_t first_binding, uint32_t binding_count,
+                                  const VkBuffer *buffers, const VkDeviceSize *offsets) {
+    bool redundant = rec.track && first_binding + binding_count <= COMMAND_RECORDER_MAX_VERTEX_BINDINGS;
+    for (uint32_t i = 0; redundant && i < binding_count; i++) {
+        redundant = rec.vertex_buffers[first_binding + i] == buffers[i] && rec.vertex_offsets[first_binding + i] == offsets[i];
+    }
+    if (redundant) {
+        rec.filtered++;
+        return;
+    }
+    vkCmdBindVertexBuffers(rec.cmd, first_binding, binding_count, buffers, offsets);
+    rec.issued++;
+
+    for (uint32_t i = 0; i < binding_count && first_binding + i < COMMAND_RECORDER_MAX_VERTEX_BINDINGS; i++) {
+        rec.vertex_buffers[first_binding + i] = buffers[i];
+        rec.vertex_offsets[first_binding + i] = offsets[i];
+    }
+}
+
+void recorder_set_viewport(command_recorder &rec, uint32_t first_viewport, uint32_t viewport_count,
+                           const VkViewport *viewports) {
+    bool single = first_viewport == 0 && viewport_count == 1;
+    if (rec.track && single && rec.viewport_valid && memcmp(&rec.viewport, viewports, sizeof(VkViewport)) == 0) {
+        rec.filtered++;
+        return;
+    }
+    vkCmdSetViewport(rec.cmd, first_viewport, viewport_count, viewports);
+    rec.issued++;
+    rec.viewport_valid = single;
+    if (single) rec.viewport = viewports[0];
+}
+
+void recorder_set_scissor(command_recorder &rec, uint32_t first_scissor, uint32_t scissor_count,
+                          const VkRect2D *scissors) {
+    bool single = first_scissor == 0 && scissor_count == 1;
+    if (rec.track && single && rec.scissor_valid && memcmp(&rec.scissor, scissors, sizeof(VkRect2D)) == 0) {
+        rec.filtered++;
+        return;
+    }
+    vkCmdSetScissor(rec.cmd, first_scissor, scissor_count, scissors);
+    rec.issued++;
+    rec.scissor_valid = single;
+    if (single) rec.scissor = scissors[0];
+}
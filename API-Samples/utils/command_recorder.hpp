@@ -0,0 +1,64 @@
+#ifndef COMMAND_RECORDER
+#define COMMAND_RECORDER
+
+#include "util.hpp"
+
+/* Descriptor sets and vertex bindings tracked, calls touching higher ones always go through */
+#define COMMAND_RECORDER_MAX_SETS 4
+#define COMMAND_RECORDER_MAX_VERTEX_BINDINGS 4
+#define COMMAND_RECORDER_MAX_DYNAMIC_OFFSETS 4
+
+/*
+ * Wraps a command buffer being recorded and drops graphics state commands
+ * that would set what is already bound.  State is per command buffer, so
+ * binds are filtered across render passes but never across command buffers.
+ */
+struct command_recorder {
+    VkCommandBuffer cmd;
+    bool track; // When false every call goes through, but is still counted
+
+    VkPipeline pipeline;
+    VkPipelineLayout set_layouts[COMMAND_RECORDER_MAX_SETS];
+    VkDescriptorSet sets[COMMAND_RECORDER_MAX_SETS];
+    uint32_t dynamic_offset_counts[COMMAND_RECORDER_MAX_SETS];
+    uint32_t dynamic_offsets[COMMAND_RECORDER_MAX_SETS][COMMAND_RECORDER_MAX_DYNAMIC_OFFSETS];
+    VkBuffer vertex_buffers[COMMAND_RECORDER_MAX_VERTEX_BINDINGS];
+    VkDeviceSize vertex_offsets[COMMAND_RECORDER_MAX_VERTEX_BINDINGS];
+    bool viewport_valid;
+    VkViewport viewport;
+    bool scissor_valid;
+    VkRect2D scissor;
+
+    uint32_t issued;
+    uint32_t filtered;
+};
+
+/*
+ * Starts tracking cmd, which has just begun recording and has nothing bound.
+ * Call it again after vkCmdExecuteCommands(), which leaves the state
+ * undefined.
+ */
+void init_command_recorder(command_recorder &rec, VkCommandBuffer cmd, bool track = true);
+
+void recorder_bind_pipeline(command_recorder &rec, VkPipeline pipeline);
+
+/*
+ * Sets bound with dynamic offsets are only tracked when a single set is
+ * bound, which then owns all of them; other binds with dynamic offsets
+ * always go through
+ */
+void recorder_bind_descriptor_sets(command_recorder &rec, VkPipelineLayout layout, uint32_t first_set,
+                                   uint32_t set_count, const VkDescriptorSet *sets, uint32_t dynamic_offset_count,
+                                   const uint32_t *dynamic_offsets);
+void recorder_bind_vertex_buffers(command_recorder &rec, uint32_t first_binding, uint32_t binding_count,
+                                  const VkBuffer *buffers, const VkDeviceSize *offsets);
+
+/*
+ * Only a single viewport or scissor at index 0 is tracked
+ */
+void recorder_set_viewport(command_recorder &rec, uint32_t first_viewport, uint32_t viewport_count,
+                           const VkViewport *viewports);
+void recorder_set_scissor(command_recorder &rec, uint32_t first_scissor, uint32_t scissor_count,
+                          const VkRect2D *scissors);
+
+#endif // COMMAND_RECORDER
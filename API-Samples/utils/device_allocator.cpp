@@ -0,0 +1,259 @@
+/*
+VULKAN_SAMPLE_DESCRIPTION
+samples device memory sub-allocator
+*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <algorithm>
+#include <set>
+#include <vector>
+#include "device_allocator.hpp"
+#include "benchmark_trace.hpp"
+
+// Chunk sizes from DEVICE_ALLOCATOR_MIN_CHUNK to DEVICE_ALLOCATOR_BLOCK_SIZE
+#define DEVICE_ALLOCATOR_CLASS_COUNT 17
+static_assert((DEVICE_ALLOCATOR_MIN_CHUNK << (DEVICE_ALLOCATOR_CLASS_COUNT - 1)) == DEVICE_ALLOCATOR_BLOCK_SIZE,
+              "DEVICE_ALLOCATOR_CLASS_COUNT does not match the block and chunk sizes");
+
+struct allocator_block {
+    VkDeviceMemory memory;
+    uint8_t *mapped;
+    uint32_t allocations;
+    std::set<VkDeviceSize> free_chunks[DEVICE_ALLOCATOR_CLASS_COUNT]; // Offsets of the free chunks of each class
+};
+
+/*
+ * Freed blocks leave a NULL behind, so device_allocation::block stays valid
+ * for the other blocks of the pool
+ */
+struct allocator_pool {
+    std::vector<allocator_block *> blocks;
+};
+
+// Two pools per memory type, [1] for optimal images when they cannot share pages with linear resources
+static std::vector<allocator_pool> allocator_pools;
+static bool allocator_split_optimal = false;
+static uint32_t allocator_dedicated = 0;
+static VkDeviceSize allocator_dedicated_bytes = 0;
+static uint32_t allocator_allocations = 0;
+static uint64_t allocator_total_allocations = 0;
+static VkDeviceSize allocator_requested = 0;
+
+static VkDeviceSize chunk_size(uint32_t size_class) { return DEVICE_ALLOCATOR_MIN_CHUNK << size_class; }
+
+// Smallest class whose chunks fit size, aligned chunks start at a multiple of their size
+static uint32_t chunk_class(VkDeviceSize size, VkDeviceSize alignment) {
+    VkDeviceSize needed = std::max(size, alignment);
+    uint32_t size_class = 0;
+    while (chunk_size(size_class) < needed) size_class++;
+    return size_class;
+}
+
+static bool host_visible_type(struct sample_info &info, uint32_t memory_type) {
+    return (info.memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
+
+static VkDeviceMemory allocate_memory(struct sample_info &info, uint32_t memory_type, VkDeviceSize size, bool map,
+                                      uint8_t **mapped) {
+    VkResult U_ASSERT_ONLY res;
+    VkMemoryAllocateInfo alloc_info = {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.pNext = NULL;
+    alloc_info.allocationSize = size;
+    alloc_info.memoryTypeIndex = memory_type;
+
+    VkDeviceMemory memory;
+    res = vkAllocateMemory(info.device, &alloc_info, NULL, &memory);
+    assert(res == VK_SUCCESS);
+
+    *mapped = NULL;
+    if (map && host_visible_type(info, memory_type)) {
+        res = vkMapMemory(info.device, memory, 0, VK_WHOLE_SIZE, 0, (void **)mapped);
+        assert(res == VK_SUCCESS);
+    }
+    return memory;
+}
+
+void init_device_allocator(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
+    allocator_pools.clear();
+    allocator_pools.resize(2 * info.memory_properties.memoryTypeCount);
+    allocator_split_optimal = info.gpu_props.limits.bufferImageGranularity > 1;
+    allocator_dedicated = 0;
+    allocator_dedicated_bytes = 0;
+    allocator_allocations = 0;
+    allocator_total_allocations = 0;
+    allocator_requested = 0;
+}
+
+void destroy_device_allocator(struct sample_info &info) {
+    if (allocator_allocations) printf("\n%u device memory allocations were never freed\n", allocator_allocations);
+    for (size_t p = 0; p < allocator_pools.size(); p++) {
+        for (size_t b = 0; b < allocator_pools[p].blocks.size(); b++) {
+            allocator_block *block = allocator_pools[p].blocks[b];
+            if (!block) continue;
+            vkFreeMemory(info.device, block->memory, NULL);
+            delete block;
+        }
+    }
+    allocator_pools.clear();
+}
+
+bool device_alloc(struct sample_info &info, const VkMemoryRequirements &reqs, VkFlags requirements_mask, bool linear,
+                  device_allocation &alloc, bool dedicated) {
+    uint32_t memory_type;
+    if (!memory_type_from_properties(info, reqs.memoryTypeBits, requirements_mask, &memory_type)) return false;
+
+    alloc.size = reqs.size;
+    alloc.pool = 2 * memory_type + (!linear && allocator_split_optimal ? 1 : 0);
+    allocator_allocations++;
+    allocator_total_allocations++;
+    allocator_requested += reqs.size;
+
+    if (dedicated || reqs.size > DEVICE_ALLOCATOR_BLOCK_SIZE || reqs.alignment > DEVICE_ALLOCATOR_BLOCK_SIZE) {
+        alloc.memory = allocate_memory(info, memory_type, reqs.size, !dedicated, &alloc.mapped);
+        alloc.offset = 0;
+        alloc.block = UINT32_MAX;
+        alloc.size_class = 0;
+        allocator_dedicated++;
+        allocator_dedicated_bytes += reqs.size;
+        return true;
+    }
+
+    // Best fit, the block with the smallest free chunk that is big enough
+    allocator_pool &pool = allocator_pools[alloc.pool];
+    const uint32_t size_class = chunk_class(reqs.size, reqs.alignment);
+    uint32_t best_block = UINT32_MAX;
+    uint32_t best_class = DEVICE_ALLOCATOR_CLASS_COUNT;
+    for (uint32_t b = 0; b < pool.blocks.size(); b++) {
+        if (!pool.blocks[b]) continue;
+        for (uint32_t c = size_class; c < best_class; c++) {
+            if (!pool.blocks[b]->free_chunks[c].empty()) {
+                best_block = b;
+                best_class = c;
+                break;
+            }
+        }
+    }
+
+    if (best_block == UINT32_MAX) {
+        allocator_block *block = new allocator_block();
+        block->memory = allocate_memory(info, memory_type, DEVICE_ALLOCATOR_BLOCK_SIZE, true, &block->mapped);
+        block->allocations = 0;
+        block->free_chunks[DEVICE_ALLOCATOR_CLASS_COUNT - 1].insert(0);
+        for (best_block = 0; best_block < pool.blocks.size() && pool.blocks[best_block]; best_block++) {
+        }
+        if (best_block == pool.blocks.size()) pool.blocks.push_back(NULL);
+        pool.blocks[best_block] = block;
+        best_class = DEVICE_ALLOCATOR_CLASS_COUNT - 1;
+    }
+
+    // Split the chunk, keeping the low halves and freeing the high ones
+    allocator_block *block = pool.blocks[best_block];
+    VkDeviceSize offset = *block->free_chunks[best_class].begin();
+    block->free_chunks[best_class].erase(block->free_chunks[best_class].begin());
+    while (best_class > size_class) {
+        best_class--;
+        block->free_chunks[best_class].insert(offset + chunk_size(best_class));
+    }
+    block->allocations++;
+
+    alloc.memory = block->memory;
+    alloc.offset = offset;
+    alloc.mapped = block->mapped ? block->mapped + offset : NULL;
+    alloc.block = best_block;
+    alloc.size_class = size_class;
+    return true;
+}
+
+void device_free(struct sample_info &info, device_allocation &alloc) {
+    if (alloc.memory == VK_NULL_HANDLE) return;
+    allocator_allocations--;
+    allocator_requested -= alloc.size;
+
+    if (alloc.block == UINT32_MAX) {
+        vkFreeMemory(info.device, alloc.memory, NULL);
+        allocator_dedicated--;
+        allocator_dedicated_bytes -= alloc.size;
+    } else {
+        allocator_pool &pool = allocator_pools[alloc.pool];
+        allocator_block *block = pool.blocks[alloc.block];
+        VkDeviceSize offset = alloc.offset;
+        uint32_t size_class = alloc.size_class;
+
+        // Merge with the other half of the parent chunk for as long as it is free
+        while (size_class < DEVICE_ALLOCATOR_CLASS_COUNT - 1) {
+            std::set<VkDeviceSize>::iterator buddy = block->free_chunks[size_class].find(offset ^ chunk_size(size_class));
+            if (buddy == block->free_chunks[size_class].end()) break;
+            block->free_chunks[size_class].erase(buddy);
+            offset &= ~chunk_size(size_class);
+            size_class++;
+        }
+        block->free_chunks[size_class].insert(offset);
+
+        if (--block->allocations == 0) {
+            vkFreeMemory(info.device, block->memory, NULL);
+            delete block;
+            pool.blocks[alloc.block] = NULL;
+        }
+    }
+    alloc = device_allocation();
+}
+
+bool device_alloc_buffer(struct sample_info &info, VkBuffer buf, VkFlags requirements_mask, device_allocation &alloc,
+                         bool dedicated) {
+    VkResult U_ASSERT_ONLY res;
+    VkMemoryRequirements mem_reqs;
+    vkGetBufferMemoryRequirements(info.device, buf, &mem_reqs);
+    if (!device_alloc(info, mem_reqs, requirements_mask, true, alloc, dedicated)) return false;
+    res = vkBindBufferMemory(info.device, buf, alloc.memory, alloc.offset);
+    assert(res == VK_SUCCESS);
+    return true;
+}
+
+bool device_alloc_image(struct sample_info &info, VkImage image, VkImageTiling tiling, VkFlags requirements_mask,
+                        device_allocation &alloc) {
+    VkResult U_ASSERT_ONLY res;
+    VkMemoryRequirements mem_reqs;
+    vkGetImageMemoryRequirements(info.device, image, &mem_reqs);
+    if (!device_alloc(info, mem_reqs, requirements_mask, tiling == VK_IMAGE_TILING_LINEAR, alloc)) return false;
+    res = vkBindImageMemory(info.device, image, alloc.memory, alloc.offset);
+    assert(res == VK_SUCCESS);
+    return true;
+}
+
+void get_device_allocator_stats(device_allocator_stats &stats) {
+    stats.memory_objects = allocator_dedicated;
+    stats.allocations = allocator_allocations;
+    stats.total_allocations = allocator_total_allocations;
+    stats.requested = allocator_requested;
+    stats.footprint = allocator_dedicated_bytes;
+    stats.free_bytes = 0;
+    stats.largest_free = 0;
+    for (size_t p = 0; p < allocator_pools.size(); p++) {
+        for (size_t b = 0; b < allocator_pools[p].blocks.size(); b++) {
+            allocator_block *block = allocator_pools[p].blocks[b];
+            if (!block) continue;
+            stats.memory_objects++;
+            stats.footprint += DEVICE_ALLOCATOR_BLOCK_SIZE;
+            for (uint32_t c = 0; c < DEVICE_ALLOCATOR_CLASS_COUNT; c++) {
+                stats.free_bytes += block->free_chunks[c].size() * chunk_size(c);
+                if (!block->free_chunks[c].empty()) stats.largest_free = std::max(stats.largest_free, chunk_size(c));
+            }
+        }
+    }
+}
+
+void append_device_allocator_metrics(benchmark_metrics &metrics) {
+    device_allocator_stats stats;
+    get_device_allocator_stats(stats);
+    metrics.push_back(std::make_pair(std::string("device_memory_objects"), (double)stats.memory_objects));
+    metrics.push_back(std::make_pair(std::string("device_allocations"), (double)stats.allocations));
+    metrics.push_back(std::make_pair(std::string("device_total_allocations"), (double)stats.total_allocations));
+    metrics.push_back(std::make_pair(std::string("device_memory_footprint_kb"), stats.footprint / 1024.0));
+    metrics.push_back(std::make_pair(std::string("device_memory_used_pct"),
+                                     stats.footprint ? 100.0 * stats.requested / stats.footprint : 0.0));
+    metrics.push_back(std::make_pair(std::string("device_memory_fragmentation"),
+                                     stats.free_bytes ? 1.0 - (double)stats.largest_free / stats.free_bytes : 0.0));
+}
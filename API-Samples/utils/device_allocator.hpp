@@ -0,0 +1,75 @@
+#ifndef DEVICE_ALLOCATOR
+#define DEVICE_ALLOCATOR
+
+#include "util.hpp"
+#include "benchmark_stats.hpp"
+
+/*
+ * Device memory is allocated in blocks of DEVICE_ALLOCATOR_BLOCK_SIZE and
+ * split into power of two chunks, from DEVICE_ALLOCATOR_MIN_CHUNK up to the
+ * whole block.  Anything bigger than a block gets memory of its own.
+ */
+#define DEVICE_ALLOCATOR_BLOCK_SIZE ((VkDeviceSize)16 << 20)
+#define DEVICE_ALLOCATOR_MIN_CHUNK ((VkDeviceSize)256)
+
+/*
+ * Sub-allocator for the device memory of the utils' buffers and images, so
+ * a sample holds a few vkAllocateMemory objects instead of one per
+ * resource.  Each memory type has a pool of blocks, and every block keeps a
+ * free list per chunk size class.  A chunk is split in halves until it fits
+ * an allocation and merged with its free other half when freed (a buddy
+ * allocator), so every chunk is aligned to its own size, and a block is
+ * freed once it is empty.
+ *
+ * Linear resources (buffers and linear images) and optimal images get
+ * pools of their own when bufferImageGranularity is above 1, so they never
+ * share a granularity page.  Blocks of host visible types stay mapped,
+ * device_allocation::mapped points at each allocation.
+ *
+ * Only init and teardown code allocates, so there is no locking.
+ */
+void init_device_allocator(struct sample_info &info);
+
+/*
+ * Frees every block.  Allocations still alive are reported.
+ */
+void destroy_device_allocator(struct sample_info &info);
+
+/*
+ * Returns false when no memory type in reqs.memoryTypeBits has all of
+ * requirements_mask, like memory_type_from_properties().  A dedicated
+ * allocation gets a memory object of its own that is left unmapped, for
+ * callers that map it themselves.
+ */
+bool device_alloc(struct sample_info &info, const VkMemoryRequirements &reqs, VkFlags requirements_mask, bool linear,
+                  device_allocation &alloc, bool dedicated = false);
+void device_free(struct sample_info &info, device_allocation &alloc);
+
+/*
+ * Allocate memory for a buffer or image and bind it
+ */
+bool device_alloc_buffer(struct sample_info &info, VkBuffer buf, VkFlags requirements_mask, device_allocation &alloc,
+                         bool dedicated = false);
+bool device_alloc_image(struct sample_info &info, VkImage image, VkImageTiling tiling, VkFlags requirements_mask,
+                        device_allocation &alloc);
+
+struct device_allocator_stats {
+    uint32_t memory_objects;      // Live vkAllocateMemory objects, blocks and dedicated
+    uint32_t allocations;         // Live allocations
+    uint64_t total_allocations;   // Every device_alloc() so far
+    VkDeviceSize requested;       // Bytes the live allocations asked for
+    VkDeviceSize footprint;       // Bytes of device memory held
+    VkDeviceSize free_bytes;      // In free chunks of the blocks
+    VkDeviceSize largest_free;    // Biggest free chunk
+};
+void get_device_allocator_stats(device_allocator_stats &stats);
+
+/*
+ * device_memory_objects, device_allocations, device_total_allocations,
+ * device_memory_footprint_kb, device_memory_used_pct (requested bytes over
+ * the footprint) and device_memory_fragmentation (1 - largest free chunk
+ * over all free bytes, 0 with nothing free)
+ */
+void append_device_allocator_metrics(benchmark_metrics &metrics);
+
+#endif // DEVICE_ALLOCATOR
@@ -1,8 +1,153 @@
-#include <util_init.hpp>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "draw_benchmarks.hpp"
+#include "benchmark_threads.hpp"
+#include "command_recorder.hpp"
+#include "benchmark_trace.hpp"
+#include "device_allocator.hpp"
 
-void primaryCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values, VkFence drawFence, VkSemaphore imageAcquiredSemaphore)
+static benchmark_worker_pool benchmark_workers;
+static latency_histogram threaded_record_times;
+static latency_histogram threaded_execute_times;
+
+/* Index into the running scenario's variants */
+static uint32_t benchmark_variant;
+
+/*
+ * Submits the frame's command buffers and presents it.  The command buffers
+ * go cmd_bufs_per_info to a VkSubmitInfo and infos_per_call VkSubmitInfos to
+ * a vkQueueSubmit() (0 for all of them).  Only the first batch waits for the
+ * acquired image and only the last call signals the frame's fence, which
+ * also covers the calls before it.  Nothing waits here: the frame's fence is
+ * waited on the next time its slot comes round.  Returns the CPU time spent
+ * in vkQueueSubmit().
+ */
+static uint64_t submit_batches_and_present(sample_info &info, const VkCommandBuffer *cmd_bufs, uint32_t cmd_buf_count,
+                                           uint32_t cmd_bufs_per_info, uint32_t infos_per_call)
+{
+  VkResult U_ASSERT_ONLY res;
+  frame_slot &slot = info.frames_in_flight[info.current_frame];
+  const bool present = info.swap_chain != VK_NULL_HANDLE;
+
+  // With --pipeline-stats each submitted command buffer holds one query
+  info.pipeline_stats_query_count = cmd_buf_count;
+
+  if (cmd_bufs_per_info == 0) cmd_bufs_per_info = cmd_buf_count;
+  const uint32_t info_count = (cmd_buf_count + cmd_bufs_per_info - 1) / cmd_bufs_per_info;
+  if (infos_per_call == 0) infos_per_call = info_count;
+
+  VkPipelineStageFlags pipe_stage_flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  static std::vector<VkSubmitInfo> submit_info;
+  submit_info.resize(info_count);
+  for (uint32_t i = 0; i < info_count; i++) {
+    uint32_t first = i * cmd_bufs_per_info;
+    submit_info[i].pNext = NULL;
+    submit_info[i].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info[i].waitSemaphoreCount = present && i == 0 ? 1 : 0;
+    submit_info[i].pWaitSemaphores = &slot.image_acquired;
+    submit_info[i].pWaitDstStageMask = &pipe_stage_flags;
+    submit_info[i].commandBufferCount = cmd_buf_count - first < cmd_bufs_per_info ? cmd_buf_count - first : cmd_bufs_per_info;
+    submit_info[i].pCommandBuffers = cmd_bufs + first;
+    submit_info[i].signalSemaphoreCount = present && i == info_count - 1 ? 1 : 0;
+    submit_info[i].pSignalSemaphores = &slot.render_complete;
+  }
+
+  // Queue the command buffers for execution
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_SUBMIT);
+  uint64_t submit_start_ns = benchmark_timestamp_ns();
+  for (uint32_t i = 0; i < info_count; i += infos_per_call) {
+    TRACE_ZONE("queue", "vkQueueSubmit");
+    uint32_t count = info_count - i < infos_per_call ? info_count - i : infos_per_call;
+    res = vkQueueSubmit(info.graphics_queue, count, &submit_info[i], i + count == info_count ? slot.fence : VK_NULL_HANDLE);
+    assert(res == VK_SUCCESS);
+  }
+  uint64_t submit_ns = benchmark_timestamp_ns() - submit_start_ns;
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_SUBMIT);
+
+  // Samples rendering to an offscreen framebuffer have nothing to present
+  if (!present) return submit_ns;
+
+  // Now present the image in the window, once rendering to it is done
+
+  VkPresentInfoKHR present_info;
+  present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+  present_info.pNext = NULL;
+  present_info.swapchainCount = 1;
+  present_info.pSwapchains = &info.swap_chain;
+  present_info.pImageIndices = &info.current_buffer;
+  present_info.pWaitSemaphores = &slot.render_complete;
+  present_info.waitSemaphoreCount = 1;
+  present_info.pResults = NULL;
+
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_PRESENT);
+  {
+    TRACE_ZONE("queue", "vkQueuePresentKHR");
+    res = vkQueuePresentKHR(info.present_queue, &present_info);
+  }
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_PRESENT);
+  assert(res == VK_SUCCESS);
+  return submit_ns;
+}
+
+/*
+ * Submits every command buffer of the frame in one VkSubmitInfo
+ */
+static void submit_and_present(sample_info &info, const VkCommandBuffer *cmd_bufs, uint32_t cmd_buf_count)
+{
+  submit_batches_and_present(info, cmd_bufs, cmd_buf_count, 0, 1);
+}
+
+/*
+ * Records the vertex buffers and dynamic state of the benchmark draws,
+ * which do not depend on the pipeline layout
+ */
+static void record_benchmark_vertex_state(sample_info &info, VkCommandBuffer cmd)
+{
+  const VkDeviceSize offsets[1] = {0};
+  vkCmdBindVertexBuffers(cmd, 0, 1, &info.vertex_buffer.buf, offsets);
+  // The pipeline reads binding 1 as well when the sample has one
+  if (info.instance_buffer.buf != VK_NULL_HANDLE) vkCmdBindVertexBuffers(cmd, 1, 1, &info.instance_buffer.buf, offsets);
+#ifndef __ANDROID__
+  // Same dynamic state as init_viewports() and init_scissors()
+  VkViewport viewport = {0.0f, 0.0f, (float)info.width, (float)info.height, 0.0f, 1.0f};
+  VkRect2D scissor = {{0, 0}, {(uint32_t)info.width, (uint32_t)info.height}};
+  vkCmdSetViewport(cmd, 0, NUM_VIEWPORTS, &viewport);
+  vkCmdSetScissor(cmd, 0, NUM_SCISSORS, &scissor);
+#endif
+}
+
+/*
+ * Records the state every benchmark draw uses.  Nothing in info is written,
+ * so worker threads can share it.
+ */
+static void record_benchmark_state(sample_info &info, VkCommandBuffer cmd)
+{
+  const uint32_t uniform_offset = get_uniform_buffer_offset(info);
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, info.pipeline);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, info.pipeline_layout, 0, NUM_DESCRIPTOR_SETS,
+                          info.desc_set.data(), 1, &uniform_offset);
+  record_benchmark_vertex_state(info, cmd);
+}
+
+/*
+ * Records the state and the draw of one benchmark draw
+ */
+static void record_benchmark_draw(sample_info &info, VkCommandBuffer cmd)
+{
+  record_benchmark_state(info, cmd);
+  vkCmdDraw(cmd, 0, 1, 0, 0);
+}
+
+/*
+ * Records one primary command buffer per draw into the frame slot's cmds
+ */
+static void record_primary_per_draw(sample_info &info, VkClearValue *clear_values)
 {
   VkResult U_ASSERT_ONLY res;
+  frame_slot &slot = info.frames_in_flight[info.current_frame];
 
   VkRenderPassBeginInfo rp_begin;
   rp_begin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -22,67 +167,34 @@ void primaryCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values
   cmd_buf_info.flags = 0;
   cmd_buf_info.pInheritanceInfo = NULL;
 
-  for (int x = 0; x < NUM_BUFFERS; x++){
-    vkBeginCommandBuffer(info.cmds[x], &cmd_buf_info);
-    vkCmdBeginRenderPass(info.cmds[x], &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(info.cmds[x], VK_PIPELINE_BIND_POINT_GRAPHICS, info.pipeline);
-    vkCmdBindDescriptorSets(info.cmds[x], VK_PIPELINE_BIND_POINT_GRAPHICS, info.pipeline_layout, 0, NUM_DESCRIPTOR_SETS,
-                            info.desc_set.data(), 0, NULL);
-
-    const VkDeviceSize offsets[1] = {0};
-    vkCmdBindVertexBuffers(info.cmds[x], 0, 1, &info.vertex_buffer.buf, offsets);
-
-    init_viewports_array(info, x);
-    init_scissors_array(info, x);
-
-    vkCmdDraw(info.cmds[x], 0, 1, 0, 0);
-    vkCmdEndRenderPass(info.cmds[x]);
-    res = vkEndCommandBuffer(info.cmds[x]);
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_RECORD);
+  for (uint32_t x = 0; x < info.benchmark_draws; x++){
+    vkBeginCommandBuffer(slot.cmds[x], &cmd_buf_info);
+    if (x == 0) execute_begin_timestamp_query(info, slot.cmds[x]);
+    execute_begin_pipeline_statistics_query(info, slot.cmds[x], x);
+    vkCmdBeginRenderPass(slot.cmds[x], &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
+    record_benchmark_draw(info, slot.cmds[x]);
+    vkCmdEndRenderPass(slot.cmds[x]);
+    execute_end_pipeline_statistics_query(info, slot.cmds[x], x);
+    if (x == info.benchmark_draws - 1) execute_end_timestamp_query(info, slot.cmds[x]);
+    res = vkEndCommandBuffer(slot.cmds[x]);
     assert(res == VK_SUCCESS);
   }
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_RECORD);
+}
 
-  VkPipelineStageFlags pipe_stage_flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  VkSubmitInfo submit_info[1] = {};
-  submit_info[0].pNext = NULL;
-  submit_info[0].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submit_info[0].waitSemaphoreCount = 1;
-  submit_info[0].pWaitSemaphores = &imageAcquiredSemaphore;
-  submit_info[0].pWaitDstStageMask = &pipe_stage_flags;
-  submit_info[0].commandBufferCount = NUM_BUFFERS;
-  submit_info[0].pCommandBuffers = info.cmds;
-  submit_info[0].signalSemaphoreCount = 0;
-  submit_info[0].pSignalSemaphores = NULL;
-
-  // Queue the command buffer for execution
-  res = vkQueueSubmit(info.graphics_queue, 1, submit_info, drawFence);
-  assert(res == VK_SUCCESS);
-
-  // Now present the image in the window
-
-  VkPresentInfoKHR present;
-  present.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-  present.pNext = NULL;
-  present.swapchainCount = 1;
-  present.pSwapchains = &info.swap_chain;
-  present.pImageIndices = &info.current_buffer;
-  present.pWaitSemaphores = NULL;
-  present.waitSemaphoreCount = 0;
-  present.pResults = NULL;
-
-  // Make sure command buffer is finished before presenting
-  do {
-    res = vkWaitForFences(info.device, 1, &drawFence, VK_TRUE, FENCE_TIMEOUT);
-  } while (res == VK_TIMEOUT);
-  vkResetFences(info.device, 1, &drawFence);
+void primaryCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values)
+{
+  frame_slot &slot = info.frames_in_flight[info.current_frame];
 
-  assert(res == VK_SUCCESS);
-  res = vkQueuePresentKHR(info.present_queue, &present);
-  assert(res == VK_SUCCESS);
+  record_primary_per_draw(info, clear_values);
+  submit_and_present(info, slot.cmds.data(), info.benchmark_draws);
 }
 
-void primaryCommandBufferBenchmark2(sample_info &info, VkClearValue *clear_values, VkFence drawFence, VkSemaphore imageAcquiredSemaphore)
+void primaryCommandBufferBenchmark2(sample_info &info, VkClearValue *clear_values)
 {
   VkResult U_ASSERT_ONLY res;
+  frame_slot &slot = info.frames_in_flight[info.current_frame];
 
   VkRenderPassBeginInfo rp_begin;
   rp_begin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -102,80 +214,30 @@ void primaryCommandBufferBenchmark2(sample_info &info, VkClearValue *clear_value
   cmd_buf_info.flags = 0;
   cmd_buf_info.pInheritanceInfo = NULL;
 
-  vkBeginCommandBuffer(info.cmd, &cmd_buf_info);
-  for (int x = 0; x < NUM_BUFFERS; x++) {
-    vkCmdBeginRenderPass(info.cmd, &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(info.cmd,
-                      VK_PIPELINE_BIND_POINT_GRAPHICS,
-                      info.pipeline);
-    vkCmdBindDescriptorSets(info.cmd,
-                            VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            info.pipeline_layout,
-                            0,
-                            NUM_DESCRIPTOR_SETS,
-                            info.desc_set.data(),
-                            0,
-                            NULL);
-
-    const VkDeviceSize offsets[1] = {0};
-    vkCmdBindVertexBuffers(info.cmd,
-                           0,
-                           1,
-                           &info.vertex_buffer.buf,
-                           offsets);
-
-    init_viewports(info);
-    init_scissors(info);
-
-    vkCmdDraw(info.cmd, 0, 1, 0, 0);
-    vkCmdEndRenderPass(info.cmd);
-  }
-  res = vkEndCommandBuffer(info.cmd);
-  assert(res == VK_SUCCESS);
-
-  const VkCommandBuffer cmd_bufs[] = {info.cmd};
-  VkPipelineStageFlags pipe_stage_flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  VkSubmitInfo submit_info[1] = {};
-  submit_info[0].pNext = NULL;
-  submit_info[0].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submit_info[0].waitSemaphoreCount = 1;
-  submit_info[0].pWaitSemaphores = &imageAcquiredSemaphore;
-  submit_info[0].pWaitDstStageMask = &pipe_stage_flags;
-  submit_info[0].commandBufferCount = 1;
-  submit_info[0].pCommandBuffers = cmd_bufs;
-  submit_info[0].signalSemaphoreCount = 0;
-  submit_info[0].pSignalSemaphores = NULL;
-
-  // Queue the command buffer for execution
-  res = vkQueueSubmit(info.graphics_queue, 1, submit_info, drawFence);
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_RECORD);
+  vkBeginCommandBuffer(slot.cmd, &cmd_buf_info);
+  execute_begin_timestamp_query(info, slot.cmd);
+  execute_begin_pipeline_statistics_query(info, slot.cmd, 0);
+  for (uint32_t x = 0; x < info.benchmark_draws; x++) {
+    vkCmdBeginRenderPass(slot.cmd, &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
+    record_benchmark_draw(info, slot.cmd);
+    vkCmdEndRenderPass(slot.cmd);
+  }
+  execute_end_pipeline_statistics_query(info, slot.cmd, 0);
+  execute_end_timestamp_query(info, slot.cmd);
+  res = vkEndCommandBuffer(slot.cmd);
   assert(res == VK_SUCCESS);
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_RECORD);
 
-  // Now present the image in the window
-
-  VkPresentInfoKHR present;
-  present.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-  present.pNext = NULL;
-  present.swapchainCount = 1;
-  present.pSwapchains = &info.swap_chain;
-  present.pImageIndices = &info.current_buffer;
-  present.pWaitSemaphores = NULL;
-  present.waitSemaphoreCount = 0;
-  present.pResults = NULL;
-
-  // Make sure command buffer is finished before presenting
-  do {
-    res = vkWaitForFences(info.device, 1, &drawFence, VK_TRUE, FENCE_TIMEOUT);
-  } while (res == VK_TIMEOUT);
-  vkResetFences(info.device, 1, &drawFence);
-
-  assert(res == VK_SUCCESS);
-  res = vkQueuePresentKHR(info.present_queue, &present);
-  assert(res == VK_SUCCESS);
+  submit_and_present(info, &slot.cmd, 1);
 }
 
-void secondaryCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values, VkFence drawFence, VkSemaphore imageAcquiredSemaphore)
+void secondaryCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values)
 {
   VkResult U_ASSERT_ONLY res;
+  frame_slot &slot = info.frames_in_flight[info.current_frame];
+
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_RECORD);
 
   // Record Secondary Command Buffer
   VkCommandBufferInheritanceInfo inherit_info = {};
@@ -186,7 +248,8 @@ void secondaryCommandBufferBenchmark(sample_info &info, VkClearValue *clear_valu
   inherit_info.framebuffer = info.framebuffers[info.current_buffer];
   inherit_info.occlusionQueryEnable = false;
   inherit_info.queryFlags = 0;
-  inherit_info.pipelineStatistics = 0;
+  // The secondaries execute inside the primary's statistics query
+  inherit_info.pipelineStatistics = info.pipeline_stats_pool != VK_NULL_HANDLE ? PIPELINE_STATISTICS_FLAGS : 0;
 
   VkCommandBufferBeginInfo secondary_cmd_buf_info = {};
   secondary_cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -194,17 +257,10 @@ void secondaryCommandBufferBenchmark(sample_info &info, VkClearValue *clear_valu
   secondary_cmd_buf_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
   secondary_cmd_buf_info.pInheritanceInfo = &inherit_info;
 
-  for (int x = 0; x < NUM_BUFFERS; x++){
-    vkBeginCommandBuffer(info.cmd2s[x], &secondary_cmd_buf_info);
-    vkCmdBindPipeline(info.cmd2s[x], VK_PIPELINE_BIND_POINT_GRAPHICS, info.pipeline);
-    vkCmdBindDescriptorSets(info.cmd2s[x], VK_PIPELINE_BIND_POINT_GRAPHICS, info.pipeline_layout, 0, NUM_DESCRIPTOR_SETS,
-                            info.desc_set.data(), 0, NULL);
-    const VkDeviceSize offsets[1] = {0};
-    vkCmdBindVertexBuffers(info.cmd2s[x], 0, 1, &info.vertex_buffer.buf, offsets);
-    init_viewports2_array(info, x);
-    init_scissors2_array(info, x);
-    vkCmdDraw(info.cmd2s[x], 0, 1, 0, 0);
-    vkEndCommandBuffer(info.cmd2s[x]);
+  for (uint32_t x = 0; x < info.benchmark_draws; x++){
+    vkBeginCommandBuffer(slot.cmd2s[x], &secondary_cmd_buf_info);
+    record_benchmark_draw(info, slot.cmd2s[x]);
+    vkEndCommandBuffer(slot.cmd2s[x]);
   }
   // Record Secondary Command Buffer End
 
@@ -228,52 +284,1887 @@ void secondaryCommandBufferBenchmark(sample_info &info, VkClearValue *clear_valu
   primary_cmd_buf_info.flags = 0;
   primary_cmd_buf_info.pInheritanceInfo = NULL;
 
-  vkBeginCommandBuffer(info.cmd, &primary_cmd_buf_info);
-  for (int x = 0; x < NUM_BUFFERS; x++){
-    vkCmdBeginRenderPass(info.cmd, &rp_begin, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
-    vkCmdExecuteCommands(info.cmd, 1, &info.cmd2s[x]);
-    vkCmdEndRenderPass(info.cmd);
+  vkBeginCommandBuffer(slot.cmd, &primary_cmd_buf_info);
+  execute_begin_timestamp_query(info, slot.cmd);
+  execute_begin_pipeline_statistics_query(info, slot.cmd, 0);
+  for (uint32_t x = 0; x < info.benchmark_draws; x++){
+    vkCmdBeginRenderPass(slot.cmd, &rp_begin, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    vkCmdExecuteCommands(slot.cmd, 1, &slot.cmd2s[x]);
+    vkCmdEndRenderPass(slot.cmd);
   }
-  vkEndCommandBuffer(info.cmd);
+  execute_end_pipeline_statistics_query(info, slot.cmd, 0);
+  execute_end_timestamp_query(info, slot.cmd);
+  res = vkEndCommandBuffer(slot.cmd);
+  assert(res == VK_SUCCESS);
   // Record Primary Command Buffer End
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_RECORD);
 
 
-  const VkCommandBuffer cmd_bufs[] = {info.cmd};
-  VkPipelineStageFlags pipe_stage_flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  VkSubmitInfo submit_info[1] = {};
-  submit_info[0].pNext = NULL;
-  submit_info[0].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submit_info[0].waitSemaphoreCount = 1;
-  submit_info[0].pWaitSemaphores = &imageAcquiredSemaphore;
-  submit_info[0].pWaitDstStageMask = &pipe_stage_flags;
-  submit_info[0].commandBufferCount = 1;
-  submit_info[0].pCommandBuffers = cmd_bufs;
-  submit_info[0].signalSemaphoreCount = 0;
-  submit_info[0].pSignalSemaphores = NULL;
-
-  // Queue the command buffer for execution
-  res = vkQueueSubmit(info.graphics_queue, 1, submit_info, drawFence);
+  submit_and_present(info, &slot.cmd, 1);
+}
+
+/*
+ * Read only to the workers apart from their own entries of cmd_bufs
+ */
+struct threaded_benchmark_frame {
+  VkRenderPassBeginInfo rp_begin;
+  VkCommandBufferInheritanceInfo inherit_info;
+  std::vector<VkCommandBuffer> cmd_bufs;
+};
+
+static void record_threaded_primaries(sample_info &info, benchmark_worker &worker, uint32_t first, uint32_t count,
+                                      void *data)
+{
+  VkResult U_ASSERT_ONLY res;
+  threaded_benchmark_frame &frame = *(threaded_benchmark_frame *)data;
+
+  VkCommandBufferBeginInfo cmd_buf_info = {};
+  cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  cmd_buf_info.pNext = NULL;
+  cmd_buf_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  cmd_buf_info.pInheritanceInfo = NULL;
+
+  for (uint32_t x = first; x < first + count; x++) {
+    VkCommandBuffer cmd = get_benchmark_worker_command_buffer(worker, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    frame.cmd_bufs[x] = cmd;
+
+    res = vkBeginCommandBuffer(cmd, &cmd_buf_info);
+    assert(res == VK_SUCCESS);
+    if (x == 0) execute_begin_timestamp_query(info, cmd);
+    execute_begin_pipeline_statistics_query(info, cmd, x);
+    vkCmdBeginRenderPass(cmd, &frame.rp_begin, VK_SUBPASS_CONTENTS_INLINE);
+    record_benchmark_draw(info, cmd);
+    vkCmdEndRenderPass(cmd);
+    execute_end_pipeline_statistics_query(info, cmd, x);
+    if (x == frame.cmd_bufs.size() - 1) execute_end_timestamp_query(info, cmd);
+    res = vkEndCommandBuffer(cmd);
+    assert(res == VK_SUCCESS);
+  }
+}
+
+void threadedPrimaryCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values)
+{
+  threaded_benchmark_frame frame;
+  init_render_pass_begin_info(info, frame.rp_begin);
+  frame.rp_begin.clearValueCount = 2;
+  frame.rp_begin.pClearValues = clear_values;
+  frame.cmd_bufs.resize(info.benchmark_draws);
+
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_RECORD);
+  uint64_t record_start_ns = benchmark_timestamp_ns();
+  execute_benchmark_workers(benchmark_workers, info.current_frame, info.benchmark_draws, record_threaded_primaries,
+                            &frame);
+  if (benchmark_phases_active()) latency_histogram_record(threaded_record_times, benchmark_timestamp_ns() - record_start_ns);
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_RECORD);
+
+  submit_and_present(info, frame.cmd_bufs.data(), info.benchmark_draws);
+}
+
+static void record_threaded_secondaries(sample_info &info, benchmark_worker &worker, uint32_t first, uint32_t count,
+                                        void *data)
+{
+  VkResult U_ASSERT_ONLY res;
+  threaded_benchmark_frame &frame = *(threaded_benchmark_frame *)data;
+
+  VkCommandBufferBeginInfo cmd_buf_info = {};
+  cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  cmd_buf_info.pNext = NULL;
+  cmd_buf_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  cmd_buf_info.pInheritanceInfo = &frame.inherit_info;
+
+  for (uint32_t x = first; x < first + count; x++) {
+    VkCommandBuffer cmd = get_benchmark_worker_command_buffer(worker, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    frame.cmd_bufs[x] = cmd;
+
+    res = vkBeginCommandBuffer(cmd, &cmd_buf_info);
+    assert(res == VK_SUCCESS);
+    record_benchmark_draw(info, cmd);
+    res = vkEndCommandBuffer(cmd);
+    assert(res == VK_SUCCESS);
+  }
+}
+
+/* Variants of secondary_threaded, and how many secondaries each render pass executes */
+static const char *const secondary_threaded_variants[] = {"1_per_pass", "16_per_pass", "256_per_pass", "all_in_one_pass",
+                                                          NULL};
+static const uint32_t secondary_threaded_per_pass[] = {1, 16, 256, 0}; // 0 for every draw
+
+void threadedSecondaryCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+  frame_slot &slot = info.frames_in_flight[info.current_frame];
+  uint32_t per_pass = secondary_threaded_per_pass[benchmark_variant];
+  if (per_pass == 0) per_pass = info.benchmark_draws;
+
+  threaded_benchmark_frame frame;
+  init_render_pass_begin_info(info, frame.rp_begin);
+  frame.rp_begin.clearValueCount = 2;
+  frame.rp_begin.pClearValues = clear_values;
+  frame.inherit_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  frame.inherit_info.pNext = NULL;
+  frame.inherit_info.renderPass = info.render_pass;
+  frame.inherit_info.subpass = 0;
+  frame.inherit_info.framebuffer = info.framebuffers[info.current_buffer];
+  frame.inherit_info.occlusionQueryEnable = VK_FALSE;
+  frame.inherit_info.queryFlags = 0;
+  frame.inherit_info.pipelineStatistics = info.pipeline_stats_pool != VK_NULL_HANDLE ? PIPELINE_STATISTICS_FLAGS : 0;
+  frame.cmd_bufs.resize(info.benchmark_draws);
+
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_RECORD);
+  uint64_t record_start_ns = benchmark_timestamp_ns();
+  execute_benchmark_workers(benchmark_workers, info.current_frame, info.benchmark_draws, record_threaded_secondaries,
+                            &frame);
+  uint64_t execute_start_ns = benchmark_timestamp_ns();
+
+  // The primary is recorded on this thread once every secondary is done
+  VkCommandBufferBeginInfo cmd_buf_info = {};
+  cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  cmd_buf_info.pNext = NULL;
+  cmd_buf_info.flags = 0;
+  cmd_buf_info.pInheritanceInfo = NULL;
+
+  vkBeginCommandBuffer(slot.cmd, &cmd_buf_info);
+  execute_begin_timestamp_query(info, slot.cmd);
+  execute_begin_pipeline_statistics_query(info, slot.cmd, 0);
+  for (uint32_t x = 0; x < info.benchmark_draws; x += per_pass) {
+    uint32_t count = info.benchmark_draws - x < per_pass ? info.benchmark_draws - x : per_pass;
+    vkCmdBeginRenderPass(slot.cmd, &frame.rp_begin, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    vkCmdExecuteCommands(slot.cmd, count, &frame.cmd_bufs[x]);
+    vkCmdEndRenderPass(slot.cmd);
+  }
+  execute_end_pipeline_statistics_query(info, slot.cmd, 0);
+  execute_end_timestamp_query(info, slot.cmd);
+  res = vkEndCommandBuffer(slot.cmd);
+  assert(res == VK_SUCCESS);
+
+  if (benchmark_phases_active()) {
+    uint64_t end_ns = benchmark_timestamp_ns();
+    latency_histogram_record(threaded_record_times, end_ns - record_start_ns);
+    latency_histogram_record(threaded_execute_times, end_ns - execute_start_ns);
+  }
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_RECORD);
+
+  submit_and_present(info, &slot.cmd, 1);
+}
+
+/* Variants of primary_prebaked: one primary per draw, or one primary holding every render pass */
+static const char *const prebaked_variants[] = {"per_draw", "one_buffer", NULL};
+
+/*
+ * Command buffers recorded once per swapchain image by prebakedBenchmarkBegin().
+ * Each image's submit list has room at the front and back for the frame
+ * slot's timestamp command buffers.
+ */
+static std::vector<VkCommandBuffer> prebaked_cmd_bufs;
+static std::vector<std::vector<VkCommandBuffer> > prebaked_submits;
+static uint64_t prebaked_bake_ns;
+static latency_histogram prebaked_record_times;
+
+void prebakedBenchmarkBegin(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+  const uint32_t per_image = benchmark_variant == 0 ? info.benchmark_draws : 1;
+
+  prebaked_cmd_bufs.resize(info.swapchainImageCount * per_image);
+  VkCommandBufferAllocateInfo cmd = {};
+  cmd.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  cmd.pNext = NULL;
+  cmd.commandPool = info.cmd_pool;
+  cmd.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  cmd.commandBufferCount = prebaked_cmd_bufs.size();
+  res = vkAllocateCommandBuffers(info.device, &cmd, prebaked_cmd_bufs.data());
+  assert(res == VK_SUCCESS);
+
+  // Several frames in flight can render to the same image (always, when
+  // there is no swapchain and only one framebuffer)
+  VkCommandBufferBeginInfo cmd_buf_info = {};
+  cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  cmd_buf_info.pNext = NULL;
+  cmd_buf_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+  cmd_buf_info.pInheritanceInfo = NULL;
+
+  uint64_t bake_start_ns = benchmark_timestamp_ns();
+  prebaked_submits.resize(info.swapchainImageCount);
+  for (uint32_t image = 0; image < info.swapchainImageCount; image++) {
+    VkRenderPassBeginInfo rp_begin;
+    init_render_pass_begin_info(info, rp_begin);
+    rp_begin.framebuffer = info.framebuffers[image];
+    rp_begin.clearValueCount = 2;
+    rp_begin.pClearValues = clear_values;
+
+    std::vector<VkCommandBuffer> &submit = prebaked_submits[image];
+    submit.resize(per_image + 2);
+    for (uint32_t x = 0; x < per_image; x++) {
+      VkCommandBuffer cmd_buf = prebaked_cmd_bufs[image * per_image + x];
+      submit[x + 1] = cmd_buf;
+      vkBeginCommandBuffer(cmd_buf, &cmd_buf_info);
+      for (uint32_t pass = 0; pass < info.benchmark_draws / per_image; pass++) {
+        vkCmdBeginRenderPass(cmd_buf, &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
+        record_benchmark_draw(info, cmd_buf);
+        vkCmdEndRenderPass(cmd_buf);
+      }
+      res = vkEndCommandBuffer(cmd_buf);
+      assert(res == VK_SUCCESS);
+    }
+  }
+  prebaked_bake_ns = benchmark_timestamp_ns() - bake_start_ns;
+  init_latency_histogram(prebaked_record_times);
+}
+
+/*
+ * Only the timestamps are recorded per frame, in the slot's own command
+ * buffers, since the baked ones are shared by every frame in flight.  The
+ * baked command buffers hold no pipeline statistics queries.
+ */
+void prebakedCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+  frame_slot &slot = info.frames_in_flight[info.current_frame];
+  std::vector<VkCommandBuffer> &submit = prebaked_submits[info.current_buffer];
+
+  VkCommandBufferBeginInfo cmd_buf_info = {};
+  cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  cmd_buf_info.pNext = NULL;
+  cmd_buf_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  cmd_buf_info.pInheritanceInfo = NULL;
+
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_RECORD);
+  uint64_t record_start_ns = benchmark_timestamp_ns();
+  vkBeginCommandBuffer(slot.cmd, &cmd_buf_info);
+  execute_begin_timestamp_query(info, slot.cmd);
+  res = vkEndCommandBuffer(slot.cmd);
+  assert(res == VK_SUCCESS);
+  vkBeginCommandBuffer(slot.cmds[0], &cmd_buf_info);
+  execute_end_timestamp_query(info, slot.cmds[0]);
+  res = vkEndCommandBuffer(slot.cmds[0]);
+  assert(res == VK_SUCCESS);
+  submit.front() = slot.cmd;
+  submit.back() = slot.cmds[0];
+  if (benchmark_phases_active()) latency_histogram_record(prebaked_record_times, benchmark_timestamp_ns() - record_start_ns);
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_RECORD);
+
+  submit_and_present(info, submit.data(), submit.size());
+  info.pipeline_stats_query_count = 0;
+}
+
+/*
+ * Baking one image's command buffers is what every frame costs when they are
+ * re-recorded, so rerecord_ms against record_mean_ms is the saving.
+ */
+void prebakedBenchmarkEnd(sample_info &info, benchmark_metrics &metrics)
+{
+  const double ns_to_ms = 1.0 / 1000000.0;
+  double rerecord_ns = (double)prebaked_bake_ns / info.swapchainImageCount;
+  double record_ns = latency_histogram_mean(prebaked_record_times);
+
+  metrics.push_back(std::make_pair(std::string("bake_ms"), prebaked_bake_ns * ns_to_ms));
+  metrics.push_back(std::make_pair(std::string("rerecord_ms"), rerecord_ns * ns_to_ms));
+  append_latency_metrics(prebaked_record_times, "record", metrics);
+  metrics.push_back(std::make_pair(std::string("record_saved_ms"), (rerecord_ns - record_ns) * ns_to_ms));
+
+  vkFreeCommandBuffers(info.device, info.cmd_pool, prebaked_cmd_bufs.size(), prebaked_cmd_bufs.data());
+  prebaked_cmd_bufs.clear();
+  prebaked_submits.clear();
+}
+
+/*
+ * Host memory handed to a VkCommandPool through its VkAllocationCallbacks.
+ * Only the benchmark thread uses the pools, so plain counters are enough.
+ */
+struct host_memory_stats {
+  size_t current;
+  size_t peak;
+  uint64_t allocations;
+  uint64_t frees;
+};
+
+/* Stored just before every tracked allocation */
+struct host_allocation_header {
+  void *block;
+  size_t size;
+};
+
+static void *VKAPI_PTR tracked_allocation(void *user_data, size_t size, size_t alignment,
+                                          VkSystemAllocationScope allocation_scope)
+{
+  host_memory_stats &stats = *(host_memory_stats *)user_data;
+  if (alignment < sizeof(void *)) alignment = sizeof(void *);
+
+  char *block = (char *)malloc(size + alignment + sizeof(host_allocation_header));
+  if (!block) return NULL;
+  uintptr_t first = (uintptr_t)(block + sizeof(host_allocation_header));
+  char *ptr = (char *)((first + alignment - 1) & ~(uintptr_t)(alignment - 1));
+  host_allocation_header *header = (host_allocation_header *)ptr - 1;
+  header->block = block;
+  header->size = size;
+
+  stats.current += size;
+  if (stats.current > stats.peak) stats.peak = stats.current;
+  stats.allocations++;
+  return ptr;
+}
+
+static void VKAPI_PTR tracked_free(void *user_data, void *memory)
+{
+  if (!memory) return;
+  host_memory_stats &stats = *(host_memory_stats *)user_data;
+  host_allocation_header *header = (host_allocation_header *)memory - 1;
+  stats.current -= header->size;
+  stats.frees++;
+  free(header->block);
+}
+
+static void *VKAPI_PTR tracked_reallocation(void *user_data, void *original, size_t size, size_t alignment,
+                                            VkSystemAllocationScope allocation_scope)
+{
+  if (!original) return tracked_allocation(user_data, size, alignment, allocation_scope);
+  if (size == 0) {
+    tracked_free(user_data, original);
+    return NULL;
+  }
+  void *memory = tracked_allocation(user_data, size, alignment, allocation_scope);
+  if (!memory) return NULL;
+  size_t original_size = ((host_allocation_header *)original - 1)->size;
+  memcpy(memory, original, original_size < size ? original_size : size);
+  tracked_free(user_data, original);
+  return memory;
+}
+
+/* Variants of pool_reset, one per way of getting a recordable command buffer back each frame */
+enum pool_reset_strategy {
+  POOL_RESET_BUFFER,
+  POOL_RESET_POOL,
+  POOL_RESET_TRANSIENT,
+  POOL_RESET_FREE_REALLOCATE,
+};
+static const char *const pool_reset_variants[] = {"reset_buffer", "reset_pool", "transient", "free_reallocate", NULL};
+
+/* One pool and its command buffers per frame in flight */
+static std::vector<VkCommandPool> pool_reset_pools;
+static std::vector<std::vector<VkCommandBuffer> > pool_reset_cmd_bufs;
+static host_memory_stats pool_reset_memory;
+static VkAllocationCallbacks pool_reset_allocator;
+static latency_histogram pool_reset_record_times;
+static uint64_t pool_reset_frame_allocations;
+static uint64_t pool_reset_frame_frees;
+
+static void allocate_pool_reset_command_buffers(sample_info &info, uint32_t frame)
+{
+  VkResult U_ASSERT_ONLY res;
+
+  VkCommandBufferAllocateInfo cmd = {};
+  cmd.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  cmd.pNext = NULL;
+  cmd.commandPool = pool_reset_pools[frame];
+  cmd.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  cmd.commandBufferCount = info.benchmark_draws;
+  res = vkAllocateCommandBuffers(info.device, &cmd, pool_reset_cmd_bufs[frame].data());
   assert(res == VK_SUCCESS);
+}
+
+void poolResetBenchmarkBegin(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+
+  memset(&pool_reset_memory, 0, sizeof(pool_reset_memory));
+  pool_reset_allocator.pUserData = &pool_reset_memory;
+  pool_reset_allocator.pfnAllocation = tracked_allocation;
+  pool_reset_allocator.pfnReallocation = tracked_reallocation;
+  pool_reset_allocator.pfnFree = tracked_free;
+  pool_reset_allocator.pfnInternalAllocation = NULL;
+  pool_reset_allocator.pfnInternalFree = NULL;
+
+  VkCommandPoolCreateInfo cmd_pool_info = {};
+  cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  cmd_pool_info.pNext = NULL;
+  cmd_pool_info.queueFamilyIndex = info.graphics_queue_family_index;
+  cmd_pool_info.flags = 0;
+  if (benchmark_variant == POOL_RESET_BUFFER) cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  if (benchmark_variant == POOL_RESET_TRANSIENT) cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+  pool_reset_pools.resize(info.frames_in_flight.size());
+  pool_reset_cmd_bufs.resize(info.frames_in_flight.size());
+  for (uint32_t i = 0; i < pool_reset_pools.size(); i++) {
+    res = vkCreateCommandPool(info.device, &cmd_pool_info, &pool_reset_allocator, &pool_reset_pools[i]);
+    assert(res == VK_SUCCESS);
+    pool_reset_cmd_bufs[i].resize(info.benchmark_draws);
+    allocate_pool_reset_command_buffers(info, i);
+  }
+
+  init_latency_histogram(pool_reset_record_times);
+  pool_reset_frame_allocations = 0;
+  pool_reset_frame_frees = 0;
+}
+
+/*
+ * Same work as primaryCommandBufferBenchmark(), recorded from the frame
+ * slot's own pool after getting its command buffers back the variant's way.
+ */
+void poolResetCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+  std::vector<VkCommandBuffer> &cmd_bufs = pool_reset_cmd_bufs[info.current_frame];
+  VkCommandPool pool = pool_reset_pools[info.current_frame];
+
+  VkRenderPassBeginInfo rp_begin;
+  init_render_pass_begin_info(info, rp_begin);
+  rp_begin.clearValueCount = 2;
+  rp_begin.pClearValues = clear_values;
+
+  VkCommandBufferBeginInfo cmd_buf_info = {};
+  cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  cmd_buf_info.pNext = NULL;
+  cmd_buf_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  cmd_buf_info.pInheritanceInfo = NULL;
+
+  const uint64_t allocations = pool_reset_memory.allocations;
+  const uint64_t frees = pool_reset_memory.frees;
 
-  // Now present the image in the window
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_RECORD);
+  uint64_t record_start_ns = benchmark_timestamp_ns();
+  switch (benchmark_variant) {
+  case POOL_RESET_BUFFER:
+    // vkBeginCommandBuffer() resets each buffer on its own
+    break;
+  case POOL_RESET_POOL:
+  case POOL_RESET_TRANSIENT:
+    res = vkResetCommandPool(info.device, pool, 0);
+    assert(res == VK_SUCCESS);
+    break;
+  case POOL_RESET_FREE_REALLOCATE:
+    vkFreeCommandBuffers(info.device, pool, info.benchmark_draws, cmd_bufs.data());
+    allocate_pool_reset_command_buffers(info, info.current_frame);
+    break;
+  }
+  for (uint32_t x = 0; x < info.benchmark_draws; x++) {
+    vkBeginCommandBuffer(cmd_bufs[x], &cmd_buf_info);
+    if (x == 0) execute_begin_timestamp_query(info, cmd_bufs[x]);
+    execute_begin_pipeline_statistics_query(info, cmd_bufs[x], x);
+    vkCmdBeginRenderPass(cmd_bufs[x], &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
+    record_benchmark_draw(info, cmd_bufs[x]);
+    vkCmdEndRenderPass(cmd_bufs[x]);
+    execute_end_pipeline_statistics_query(info, cmd_bufs[x], x);
+    if (x == info.benchmark_draws - 1) execute_end_timestamp_query(info, cmd_bufs[x]);
+    res = vkEndCommandBuffer(cmd_bufs[x]);
+    assert(res == VK_SUCCESS);
+  }
+  if (benchmark_phases_active()) {
+    latency_histogram_record(pool_reset_record_times, benchmark_timestamp_ns() - record_start_ns);
+    pool_reset_frame_allocations += pool_reset_memory.allocations - allocations;
+    pool_reset_frame_frees += pool_reset_memory.frees - frees;
+  }
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_RECORD);
+
+  submit_and_present(info, cmd_bufs.data(), info.benchmark_draws);
+}
+
+/*
+ * Host memory is only seen when the driver allocates through the pool's
+ * callbacks; a driver using its own allocator reports zeros.
+ */
+void poolResetBenchmarkEnd(sample_info &info, benchmark_metrics &metrics)
+{
+  append_latency_metrics(pool_reset_record_times, "record", metrics);
+  metrics.push_back(std::make_pair(std::string("pool_host_kb"), pool_reset_memory.current / 1024.0));
+  metrics.push_back(std::make_pair(std::string("pool_host_peak_kb"), pool_reset_memory.peak / 1024.0));
+  const double frames = info.benchmark_frames > 0 ? info.benchmark_frames : 1.0;
+  metrics.push_back(std::make_pair(std::string("pool_host_allocs_per_frame"), pool_reset_frame_allocations / frames));
+  metrics.push_back(std::make_pair(std::string("pool_host_frees_per_frame"), pool_reset_frame_frees / frames));
+
+  // Command buffers are freed along with their pool
+  for (uint32_t i = 0; i < pool_reset_pools.size(); i++) {
+    vkDestroyCommandPool(info.device, pool_reset_pools[i], &pool_reset_allocator);
+  }
+  pool_reset_pools.clear();
+  pool_reset_cmd_bufs.clear();
+}
+
+/*
+ * Variants of submit_batching: how the per draw command buffers are grouped
+ * into VkSubmitInfos, and those into vkQueueSubmit() calls (0 for all)
+ */
+static const char *const submit_batching_variants[] = {"1_per_submit", "16_infos_per_submit", "256_infos_per_submit",
+                                                       "all_infos_one_submit", "one_info", NULL};
+static const uint32_t submit_batching_per_info[] = {1, 1, 1, 1, 0};
+static const uint32_t submit_batching_infos_per_call[] = {1, 16, 256, 0, 1};
+static latency_histogram submit_batching_submit_times;
+static latency_histogram submit_batching_latencies;
+
+void submitBatchingBenchmarkBegin(sample_info &info, VkClearValue *clear_values)
+{
+  init_latency_histogram(submit_batching_submit_times);
+  init_latency_histogram(submit_batching_latencies);
+}
 
-  VkPresentInfoKHR present;
-  present.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-  present.pNext = NULL;
-  present.swapchainCount = 1;
-  present.pSwapchains = &info.swap_chain;
-  present.pImageIndices = &info.current_buffer;
-  present.pWaitSemaphores = NULL;
-  present.waitSemaphoreCount = 0;
-  present.pResults = NULL;
+/*
+ * The frame's fence is waited on straight after the submit, so that the
+ * latency from the first vkQueueSubmit() to the GPU finishing the frame
+ * (including the present call) is measured on its own.
+ */
+void submitBatchingCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+  frame_slot &slot = info.frames_in_flight[info.current_frame];
 
-  // Make sure command buffer is finished before presenting
+  record_primary_per_draw(info, clear_values);
+
+  uint64_t submit_start_ns = benchmark_timestamp_ns();
+  uint64_t submit_ns = submit_batches_and_present(info, slot.cmds.data(), info.benchmark_draws,
+                                                  submit_batching_per_info[benchmark_variant],
+                                                  submit_batching_infos_per_call[benchmark_variant]);
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_WAIT);
   do {
-    res = vkWaitForFences(info.device, 1, &drawFence, VK_TRUE, FENCE_TIMEOUT);
+    res = vkWaitForFences(info.device, 1, &slot.fence, VK_TRUE, FENCE_TIMEOUT);
   } while (res == VK_TIMEOUT);
-  vkResetFences(info.device, 1, &drawFence);
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_WAIT);
+  assert(res == VK_SUCCESS);
+
+  if (benchmark_phases_active()) {
+    latency_histogram_record(submit_batching_submit_times, submit_ns);
+    latency_histogram_record(submit_batching_latencies, benchmark_timestamp_ns() - submit_start_ns);
+  }
+}
+
+void submitBatchingBenchmarkEnd(sample_info &info, benchmark_metrics &metrics)
+{
+  uint32_t per_info = submit_batching_per_info[benchmark_variant];
+  uint32_t per_call = submit_batching_infos_per_call[benchmark_variant];
+  uint32_t info_count = per_info ? (info.benchmark_draws + per_info - 1) / per_info : 1;
+  uint32_t call_count = per_call ? (info_count + per_call - 1) / per_call : 1;
+
+  metrics.push_back(std::make_pair(std::string("submit_calls_per_frame"), (double)call_count));
+  append_latency_metrics(submit_batching_submit_times, "submit", metrics);
+  append_latency_metrics(submit_batching_latencies, "submit_to_complete", metrics);
+}
+
+/* Variants of indirect: the same draws recorded one call each or read from a buffer of draw commands */
+enum indirect_draw_mode {
+  INDIRECT_DIRECT,
+  INDIRECT_INDIRECT,
+  INDIRECT_INDEXED_DIRECT,
+  INDIRECT_INDEXED_INDIRECT,
+};
+static const char *const indirect_variants[] = {"direct", "indirect", "indexed_direct", "indexed_indirect", NULL};
+static VkBuffer indirect_buffer;
+static device_allocation indirect_memory;
+static latency_histogram indirect_record_times;
+static uint32_t indirect_draw_calls;
+
+static bool indirect_variant_indexed()
+{
+  return benchmark_variant == INDIRECT_INDEXED_DIRECT || benchmark_variant == INDIRECT_INDEXED_INDIRECT;
+}
+
+/*
+ * The indexed variants draw the sample's index buffer, which only some
+ * samples have
+ */
+bool indirectBenchmarkSupported(sample_info &info)
+{
+  return !indirect_variant_indexed() || info.index_buffer.buf != VK_NULL_HANDLE;
+}
+
+/*
+ * Writes the variant's draws to the indirect buffer once, they are the
+ * same every frame and the GPU only reads them
+ */
+void indirectBenchmarkBegin(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+  bool U_ASSERT_ONLY pass;
+  const bool indexed = indirect_variant_indexed();
+  const VkDeviceSize stride = indexed ? sizeof(VkDrawIndexedIndirectCommand) : sizeof(VkDrawIndirectCommand);
 
+  VkBufferCreateInfo buf_info = {};
+  buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  buf_info.pNext = NULL;
+  buf_info.usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+  buf_info.size = stride * info.benchmark_draws;
+  buf_info.queueFamilyIndexCount = 0;
+  buf_info.pQueueFamilyIndices = NULL;
+  buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  buf_info.flags = 0;
+  res = vkCreateBuffer(info.device, &buf_info, NULL, &indirect_buffer);
   assert(res == VK_SUCCESS);
-  res = vkQueuePresentKHR(info.present_queue, &present);
+
+  pass = device_alloc_buffer(info, indirect_buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                             indirect_memory);
+  assert(pass && "No mappable, coherent memory");
+
+  void *data = indirect_memory.mapped;
+  // The same draws as record_benchmark_draw(), or the whole index buffer
+  for (uint32_t x = 0; x < info.benchmark_draws; x++) {
+    if (indexed) {
+      VkDrawIndexedIndirectCommand &draw = ((VkDrawIndexedIndirectCommand *)data)[x];
+      draw.indexCount = info.index_count;
+      draw.instanceCount = 1;
+      draw.firstIndex = 0;
+      draw.vertexOffset = 0;
+      draw.firstInstance = 0;
+    } else {
+      VkDrawIndirectCommand &draw = ((VkDrawIndirectCommand *)data)[x];
+      draw.vertexCount = 0;
+      draw.instanceCount = 1;
+      draw.firstVertex = 0;
+      draw.firstInstance = 0;
+    }
+  }
+
+  init_latency_histogram(indirect_record_times);
+}
+
+/*
+ * Issues the indirect buffer's draws, as few calls as maxDrawIndirectCount
+ * allows or one call per draw without multiDrawIndirect.  Returns the
+ * number of calls.
+ */
+static uint32_t record_indirect_draws(sample_info &info, VkCommandBuffer cmd, bool indexed)
+{
+  const uint32_t stride = indexed ? sizeof(VkDrawIndexedIndirectCommand) : sizeof(VkDrawIndirectCommand);
+  const uint32_t per_call = info.multi_draw_indirect ? info.gpu_props.limits.maxDrawIndirectCount : 1;
+  uint32_t calls = 0;
+
+  for (uint32_t x = 0; x < info.benchmark_draws; x += per_call) {
+    uint32_t count = info.benchmark_draws - x < per_call ? info.benchmark_draws - x : per_call;
+    if (indexed) {
+      vkCmdDrawIndexedIndirect(cmd, indirect_buffer, (VkDeviceSize)x * stride, count, stride);
+    } else {
+      vkCmdDrawIndirect(cmd, indirect_buffer, (VkDeviceSize)x * stride, count, stride);
+    }
+    calls++;
+  }
+  return calls;
+}
+
+/*
+ * Every draw goes in one render pass of one primary with the state bound
+ * once, so only the way the draws themselves are issued differs between
+ * the variants.
+ */
+void indirectCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+  frame_slot &slot = info.frames_in_flight[info.current_frame];
+
+  VkRenderPassBeginInfo rp_begin;
+  init_render_pass_begin_info(info, rp_begin);
+  rp_begin.clearValueCount = 2;
+  rp_begin.pClearValues = clear_values;
+
+  VkCommandBufferBeginInfo cmd_buf_info = {};
+  cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  cmd_buf_info.pNext = NULL;
+  cmd_buf_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  cmd_buf_info.pInheritanceInfo = NULL;
+
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_RECORD);
+  uint64_t record_start_ns = benchmark_timestamp_ns();
+  vkBeginCommandBuffer(slot.cmd, &cmd_buf_info);
+  execute_begin_timestamp_query(info, slot.cmd);
+  execute_begin_pipeline_statistics_query(info, slot.cmd, 0);
+  vkCmdBeginRenderPass(slot.cmd, &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
+  record_benchmark_state(info, slot.cmd);
+  if (indirect_variant_indexed()) vkCmdBindIndexBuffer(slot.cmd, info.index_buffer.buf, 0, info.index_type);
+  switch (benchmark_variant) {
+  case INDIRECT_DIRECT:
+    for (uint32_t x = 0; x < info.benchmark_draws; x++) vkCmdDraw(slot.cmd, 0, 1, 0, 0);
+    indirect_draw_calls = info.benchmark_draws;
+    break;
+  case INDIRECT_INDEXED_DIRECT:
+    for (uint32_t x = 0; x < info.benchmark_draws; x++) vkCmdDrawIndexed(slot.cmd, info.index_count, 1, 0, 0, 0);
+    indirect_draw_calls = info.benchmark_draws;
+    break;
+  case INDIRECT_INDIRECT:
+  case INDIRECT_INDEXED_INDIRECT:
+    indirect_draw_calls = record_indirect_draws(info, slot.cmd, indirect_variant_indexed());
+    break;
+  }
+  vkCmdEndRenderPass(slot.cmd);
+  execute_end_pipeline_statistics_query(info, slot.cmd, 0);
+  execute_end_timestamp_query(info, slot.cmd);
+  res = vkEndCommandBuffer(slot.cmd);
   assert(res == VK_SUCCESS);
+  if (benchmark_phases_active()) latency_histogram_record(indirect_record_times, benchmark_timestamp_ns() - record_start_ns);
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_RECORD);
+
+  submit_and_present(info, &slot.cmd, 1);
+}
+
+void indirectBenchmarkEnd(sample_info &info, benchmark_metrics &metrics)
+{
+  append_latency_metrics(indirect_record_times, "record", metrics);
+  metrics.push_back(std::make_pair(std::string("draw_calls_per_frame"), (double)indirect_draw_calls));
+  metrics.push_back(std::make_pair(std::string("multi_draw_indirect"), info.multi_draw_indirect ? 1.0 : 0.0));
+
+  vkDestroyBuffer(info.device, indirect_buffer, NULL);
+  device_free(info, indirect_memory);
+}
+
+/* Variants of instanced: one draw per instance, or every instance in one draw */
+static const char *const instanced_variants[] = {"draw_per_instance", "one_draw", NULL};
+static latency_histogram instanced_record_times;
+static uint32_t instanced_draw_calls;
+
+/*
+ * Needs the sample's per-instance transforms, see init_instance_buffer()
+ */
+bool instancedBenchmarkSupported(sample_info &info)
+{
+  return info.instance_buffer.buf != VK_NULL_HANDLE;
+}
+
+void instancedBenchmarkBegin(sample_info &info, VkClearValue *clear_values)
+{
+  init_latency_histogram(instanced_record_times);
+}
+
+/*
+ * Draws the whole vertex buffer once per instance in one render pass, the
+ * separate draws picking their transform with firstInstance so that both
+ * variants run the same pipeline over the same instances.
+ */
+void instancedCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+  frame_slot &slot = info.frames_in_flight[info.current_frame];
+
+  VkRenderPassBeginInfo rp_begin;
+  init_render_pass_begin_info(info, rp_begin);
+  rp_begin.clearValueCount = 2;
+  rp_begin.pClearValues = clear_values;
+
+  VkCommandBufferBeginInfo cmd_buf_info = {};
+  cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  cmd_buf_info.pNext = NULL;
+  cmd_buf_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  cmd_buf_info.pInheritanceInfo = NULL;
+
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_RECORD);
+  uint64_t record_start_ns = benchmark_timestamp_ns();
+  vkBeginCommandBuffer(slot.cmd, &cmd_buf_info);
+  execute_begin_timestamp_query(info, slot.cmd);
+  execute_begin_pipeline_statistics_query(info, slot.cmd, 0);
+  vkCmdBeginRenderPass(slot.cmd, &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
+  record_benchmark_state(info, slot.cmd);
+  if (benchmark_variant == 0) {
+    for (uint32_t x = 0; x < info.instance_count; x++) vkCmdDraw(slot.cmd, info.vertex_count, 1, 0, x);
+    instanced_draw_calls = info.instance_count;
+  } else {
+    vkCmdDraw(slot.cmd, info.vertex_count, info.instance_count, 0, 0);
+    instanced_draw_calls = 1;
+  }
+  vkCmdEndRenderPass(slot.cmd);
+  execute_end_pipeline_statistics_query(info, slot.cmd, 0);
+  execute_end_timestamp_query(info, slot.cmd);
+  res = vkEndCommandBuffer(slot.cmd);
+  assert(res == VK_SUCCESS);
+  if (benchmark_phases_active()) latency_histogram_record(instanced_record_times, benchmark_timestamp_ns() - record_start_ns);
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_RECORD);
+
+  submit_and_present(info, &slot.cmd, 1);
+}
+
+void instancedBenchmarkEnd(sample_info &info, benchmark_metrics &metrics)
+{
+  append_latency_metrics(instanced_record_times, "record", metrics);
+  metrics.push_back(std::make_pair(std::string("draw_calls_per_frame"), (double)instanced_draw_calls));
+  metrics.push_back(std::make_pair(std::string("instances"), (double)info.instance_count));
+}
+
+/*
+ * Descriptor set layout, pipeline layout and pipeline matching the sample's
+ * apart from the descriptor type of the uniform buffer at binding 0 and an
+ * optional push constant range, for scenarios that feed per draw data
+ * another way
+ */
+struct benchmark_pipeline {
+  VkDescriptorSetLayout desc_layout;
+  VkPipelineLayout pipeline_layout;
+  VkPipeline pipeline;
+};
+
+static bool benchmark_sample_has_texture(sample_info &info)
+{
+  return info.texture_data.image_info.imageView != VK_NULL_HANDLE;
+}
+
+/*
+ * With push_constant_size set the pipeline runs the sample's push constant
+ * vertex shader, see init_push_constant_shader()
+ */
+static void init_benchmark_pipeline(sample_info &info, VkDescriptorType uniform_type, uint32_t push_constant_size,
+                                    benchmark_pipeline &pipeline)
+{
+  // The init functions build from and into the sample's fields, so swap ours in for the calls
+  std::vector<VkDescriptorSetLayout> sample_desc_layout;
+  sample_desc_layout.swap(info.desc_layout);
+  VkPipelineLayout sample_layout = info.pipeline_layout;
+  VkPipeline sample_pipeline = info.pipeline;
+
+  init_descriptor_and_pipeline_layouts(info, benchmark_sample_has_texture(info), 0, push_constant_size, uniform_type);
+  init_pipeline(info, info.depth.view != VK_NULL_HANDLE, true, push_constant_size > 0);
+  pipeline.desc_layout = info.desc_layout[0];
+  pipeline.pipeline_layout = info.pipeline_layout;
+  pipeline.pipeline = info.pipeline;
+
+  info.desc_layout.swap(sample_desc_layout);
+  info.pipeline_layout = sample_layout;
+  info.pipeline = sample_pipeline;
+}
+
+static void destroy_benchmark_pipeline(sample_info &info, benchmark_pipeline &pipeline)
+{
+  vkDestroyPipeline(info.device, pipeline.pipeline, NULL);
+  vkDestroyPipelineLayout(info.device, pipeline.pipeline_layout, NULL);
+  vkDestroyDescriptorSetLayout(info.device, pipeline.desc_layout, NULL);
+}
+
+/*
+ * Variants of uniform_per_draw: one set bound at a dynamic offset per draw,
+ * a set of its own per draw, or the data pushed as push constants per draw
+ */
+enum uniform_per_draw_mode {
+  UNIFORM_DYNAMIC_OFFSET,
+  UNIFORM_SET_PER_DRAW,
+  UNIFORM_PUSH_CONSTANTS,
+};
+static const char *const uniform_per_draw_variants[] = {"dynamic_offset", "set_per_draw", "push_constants", NULL};
+static benchmark_pipeline uniform_per_draw_pipeline;
+static VkBuffer uniform_per_draw_buffer;
+static device_allocation uniform_per_draw_memory;
+static VkDeviceSize uniform_per_draw_stride;
+static VkDescriptorPool uniform_per_draw_pool;
+static std::vector<VkDescriptorSet> uniform_per_draw_sets;
+static std::vector<uint8_t> uniform_per_draw_push_data;
+static latency_histogram uniform_per_draw_record_times;
+
+/*
+ * push_constants needs the sample's push constant vertex shader, and its
+ * uniform data has to fit in maxPushConstantsSize
+ */
+bool uniformPerDrawBenchmarkSupported(sample_info &info)
+{
+  if (benchmark_variant != UNIFORM_PUSH_CONSTANTS) return true;
+  return info.push_constant_stage.module != VK_NULL_HANDLE &&
+         info.uniform_data.buffer_info.range <= info.gpu_props.limits.maxPushConstantsSize;
+}
+
+/*
+ * Fills a uniform buffer with a copy of the sample's uniform data per draw,
+ * each at a multiple of minUniformBufferOffsetAlignment, and points the
+ * variant's descriptor sets at it
+ */
+void uniformPerDrawBenchmarkBegin(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+  bool U_ASSERT_ONLY pass;
+  const bool dynamic = benchmark_variant == UNIFORM_DYNAMIC_OFFSET;
+  const bool push = benchmark_variant == UNIFORM_PUSH_CONSTANTS;
+  const bool texture = benchmark_sample_has_texture(info);
+  const VkDeviceSize range = info.uniform_data.buffer_info.range;
+  const VkDeviceSize alignment = info.gpu_props.limits.minUniformBufferOffsetAlignment;
+
+  init_benchmark_pipeline(info, dynamic ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                          push ? range : 0, uniform_per_draw_pipeline);
+
+  uniform_per_draw_stride = (range + alignment - 1) / alignment * alignment;
+
+  VkBufferCreateInfo buf_info = {};
+  buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  buf_info.pNext = NULL;
+  buf_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+  buf_info.size = uniform_per_draw_stride * info.benchmark_draws;
+  buf_info.queueFamilyIndexCount = 0;
+  buf_info.pQueueFamilyIndices = NULL;
+  buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  buf_info.flags = 0;
+  res = vkCreateBuffer(info.device, &buf_info, NULL, &uniform_per_draw_buffer);
+  assert(res == VK_SUCCESS);
+
+  pass = device_alloc_buffer(info, uniform_per_draw_buffer,
+                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                             uniform_per_draw_memory);
+  assert(pass && "No mappable, coherent memory");
+
+  // The sample's uniform ring is always host visible and mapped, every slot holds the same data
+  const uint8_t *sample_data = info.uniform_data.mapped;
+  uint8_t *data = uniform_per_draw_memory.mapped;
+  for (uint32_t x = 0; x < info.benchmark_draws; x++) memcpy(data + x * uniform_per_draw_stride, sample_data, range);
+  // Pushed from host memory, so packed without the buffer alignment
+  uniform_per_draw_push_data.resize(push ? range * info.benchmark_draws : 0);
+  for (size_t x = 0; x < uniform_per_draw_push_data.size(); x += range) {
+    memcpy(&uniform_per_draw_push_data[x], sample_data, range);
+  }
+
+  // Pushing still needs a set for the sample's texture, bound once
+  const uint32_t set_count = dynamic || push ? 1 : info.benchmark_draws;
+  VkDescriptorPoolSize type_count[2];
+  type_count[0].type = dynamic ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  type_count[0].descriptorCount = set_count;
+  type_count[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  type_count[1].descriptorCount = set_count;
+
+  VkDescriptorPoolCreateInfo descriptor_pool = {};
+  descriptor_pool.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptor_pool.pNext = NULL;
+  descriptor_pool.maxSets = set_count;
+  descriptor_pool.poolSizeCount = texture ? 2 : 1;
+  descriptor_pool.pPoolSizes = type_count;
+  res = vkCreateDescriptorPool(info.device, &descriptor_pool, NULL, &uniform_per_draw_pool);
+  assert(res == VK_SUCCESS);
+
+  std::vector<VkDescriptorSetLayout> layouts(set_count, uniform_per_draw_pipeline.desc_layout);
+  VkDescriptorSetAllocateInfo set_alloc_info = {};
+  set_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  set_alloc_info.pNext = NULL;
+  set_alloc_info.descriptorPool = uniform_per_draw_pool;
+  set_alloc_info.descriptorSetCount = set_count;
+  set_alloc_info.pSetLayouts = layouts.data();
+  uniform_per_draw_sets.resize(set_count);
+  res = vkAllocateDescriptorSets(info.device, &set_alloc_info, uniform_per_draw_sets.data());
+  assert(res == VK_SUCCESS);
+
+  // The dynamic set's range is one draw's data, its offset comes at bind time
+  std::vector<VkDescriptorBufferInfo> buffer_infos(set_count);
+  std::vector<VkWriteDescriptorSet> writes;
+  for (uint32_t x = 0; x < set_count; x++) {
+    buffer_infos[x].buffer = uniform_per_draw_buffer;
+    buffer_infos[x].offset = x * uniform_per_draw_stride;
+    buffer_infos[x].range = range;
+
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.pNext = NULL;
+    write.dstSet = uniform_per_draw_sets[x];
+    write.dstBinding = 0;
+    write.dstArrayElement = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = type_count[0].type;
+    write.pBufferInfo = &buffer_infos[x];
+    writes.push_back(write);
+    if (texture) {
+      write.dstBinding = 1;
+      write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      write.pBufferInfo = NULL;
+      write.pImageInfo = &info.texture_data.image_info;
+      writes.push_back(write);
+    }
+  }
+  vkUpdateDescriptorSets(info.device, writes.size(), writes.data(), 0, NULL);
+
+  init_latency_histogram(uniform_per_draw_record_times);
+}
+
+/*
+ * Every draw in one render pass, each binding its own uniform data before it
+ * draws the sample's vertices
+ */
+void uniformPerDrawCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+  frame_slot &slot = info.frames_in_flight[info.current_frame];
+  const uint32_t range = info.uniform_data.buffer_info.range;
+
+  VkRenderPassBeginInfo rp_begin;
+  init_render_pass_begin_info(info, rp_begin);
+  rp_begin.clearValueCount = 2;
+  rp_begin.pClearValues = clear_values;
+
+  VkCommandBufferBeginInfo cmd_buf_info = {};
+  cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  cmd_buf_info.pNext = NULL;
+  cmd_buf_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  cmd_buf_info.pInheritanceInfo = NULL;
+
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_RECORD);
+  uint64_t record_start_ns = benchmark_timestamp_ns();
+  vkBeginCommandBuffer(slot.cmd, &cmd_buf_info);
+  execute_begin_timestamp_query(info, slot.cmd);
+  execute_begin_pipeline_statistics_query(info, slot.cmd, 0);
+  vkCmdBeginRenderPass(slot.cmd, &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
+  vkCmdBindPipeline(slot.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, uniform_per_draw_pipeline.pipeline);
+  record_benchmark_vertex_state(info, slot.cmd);
+  if (benchmark_variant == UNIFORM_PUSH_CONSTANTS) {
+    vkCmdBindDescriptorSets(slot.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, uniform_per_draw_pipeline.pipeline_layout, 0, 1,
+                            &uniform_per_draw_sets[0], 0, NULL);
+  }
+  for (uint32_t x = 0; x < info.benchmark_draws; x++) {
+    switch (benchmark_variant) {
+    case UNIFORM_DYNAMIC_OFFSET: {
+      uint32_t offset = x * uniform_per_draw_stride;
+      vkCmdBindDescriptorSets(slot.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, uniform_per_draw_pipeline.pipeline_layout, 0,
+                              1, &uniform_per_draw_sets[0], 1, &offset);
+      break;
+    }
+    case UNIFORM_SET_PER_DRAW:
+      vkCmdBindDescriptorSets(slot.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, uniform_per_draw_pipeline.pipeline_layout, 0,
+                              1, &uniform_per_draw_sets[x], 0, NULL);
+      break;
+    case UNIFORM_PUSH_CONSTANTS:
+      vkCmdPushConstants(slot.cmd, uniform_per_draw_pipeline.pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, range,
+                         &uniform_per_draw_push_data[x * range]);
+      break;
+    }
+    vkCmdDraw(slot.cmd, info.vertex_count, 1, 0, 0);
+  }
+  vkCmdEndRenderPass(slot.cmd);
+  execute_end_pipeline_statistics_query(info, slot.cmd, 0);
+  execute_end_timestamp_query(info, slot.cmd);
+  res = vkEndCommandBuffer(slot.cmd);
+  assert(res == VK_SUCCESS);
+  if (benchmark_phases_active()) {
+    latency_histogram_record(uniform_per_draw_record_times, benchmark_timestamp_ns() - record_start_ns);
+  }
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_RECORD);
+
+  submit_and_present(info, &slot.cmd, 1);
+}
+
+void uniformPerDrawBenchmarkEnd(sample_info &info, benchmark_metrics &metrics)
+{
+  append_latency_metrics(uniform_per_draw_record_times, "record", metrics);
+  metrics.push_back(std::make_pair(std::string("uniform_stride"), (double)uniform_per_draw_stride));
+  metrics.push_back(std::make_pair(std::string("descriptor_sets"), (double)uniform_per_draw_sets.size()));
+
+  // Sets are freed along with their pool
+  vkDestroyDescriptorPool(info.device, uniform_per_draw_pool, NULL);
+  uniform_per_draw_sets.clear();
+  uniform_per_draw_push_data.clear();
+  vkDestroyBuffer(info.device, uniform_per_draw_buffer, NULL);
+  device_free(info, uniform_per_draw_memory);
+  destroy_benchmark_pipeline(info, uniform_per_draw_pipeline);
+}
+
+/*
+ * Variants of state_tracking: the binds of every draw go through a
+ * command_recorder, which only counts them or also drops the redundant ones
+ */
+static const char *const state_tracking_variants[] = {"rebind", "tracked", NULL};
+static latency_histogram state_tracking_record_times;
+static uint32_t state_tracking_issued;
+static uint32_t state_tracking_filtered;
+
+void stateTrackingBenchmarkBegin(sample_info &info, VkClearValue *clear_values)
+{
+  init_latency_histogram(state_tracking_record_times);
+}
+
+/*
+ * Same binds as record_benchmark_draw(), through the recorder
+ */
+static void record_benchmark_draw_tracked(sample_info &info, command_recorder &rec)
+{
+  const uint32_t uniform_offset = get_uniform_buffer_offset(info);
+  recorder_bind_pipeline(rec, info.pipeline);
+  recorder_bind_descriptor_sets(rec, info.pipeline_layout, 0, NUM_DESCRIPTOR_SETS, info.desc_set.data(), 1,
+                                &uniform_offset);
+  const VkDeviceSize offsets[1] = {0};
+  recorder_bind_vertex_buffers(rec, 0, 1, &info.vertex_buffer.buf, offsets);
+  if (info.instance_buffer.buf != VK_NULL_HANDLE) recorder_bind_vertex_buffers(rec, 1, 1, &info.instance_buffer.buf, offsets);
+#ifndef __ANDROID__
+  VkViewport viewport = {0.0f, 0.0f, (float)info.width, (float)info.height, 0.0f, 1.0f};
+  VkRect2D scissor = {{0, 0}, {(uint32_t)info.width, (uint32_t)info.height}};
+  recorder_set_viewport(rec, 0, NUM_VIEWPORTS, &viewport);
+  recorder_set_scissor(rec, 0, NUM_SCISSORS, &scissor);
+#endif
+  vkCmdDraw(rec.cmd, 0, 1, 0, 0);
+}
+
+/*
+ * The render pass per draw of primary_single, so every draw after the first
+ * rebinds what the one before it bound.  Both variants pay for the
+ * recorder's checks, the difference between them is the driver's time for
+ * the redundant calls.
+ */
+void stateTrackingCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+  frame_slot &slot = info.frames_in_flight[info.current_frame];
+
+  VkRenderPassBeginInfo rp_begin;
+  init_render_pass_begin_info(info, rp_begin);
+  rp_begin.clearValueCount = 2;
+  rp_begin.pClearValues = clear_values;
+
+  VkCommandBufferBeginInfo cmd_buf_info = {};
+  cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  cmd_buf_info.pNext = NULL;
+  cmd_buf_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  cmd_buf_info.pInheritanceInfo = NULL;
+
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_RECORD);
+  uint64_t record_start_ns = benchmark_timestamp_ns();
+  vkBeginCommandBuffer(slot.cmd, &cmd_buf_info);
+  command_recorder rec;
+  init_command_recorder(rec, slot.cmd, benchmark_variant == 1);
+  execute_begin_timestamp_query(info, slot.cmd);
+  execute_begin_pipeline_statistics_query(info, slot.cmd, 0);
+  for (uint32_t x = 0; x < info.benchmark_draws; x++) {
+    vkCmdBeginRenderPass(slot.cmd, &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
+    record_benchmark_draw_tracked(info, rec);
+    vkCmdEndRenderPass(slot.cmd);
+  }
+  execute_end_pipeline_statistics_query(info, slot.cmd, 0);
+  execute_end_timestamp_query(info, slot.cmd);
+  res = vkEndCommandBuffer(slot.cmd);
+  assert(res == VK_SUCCESS);
+  if (benchmark_phases_active()) {
+    latency_histogram_record(state_tracking_record_times, benchmark_timestamp_ns() - record_start_ns);
+  }
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_RECORD);
+  state_tracking_issued = rec.issued;
+  state_tracking_filtered = rec.filtered;
+
+  submit_and_present(info, &slot.cmd, 1);
+}
+
+void stateTrackingBenchmarkEnd(sample_info &info, benchmark_metrics &metrics)
+{
+  append_latency_metrics(state_tracking_record_times, "record", metrics);
+  metrics.push_back(std::make_pair(std::string("binds_issued_per_frame"), (double)state_tracking_issued));
+  metrics.push_back(std::make_pair(std::string("binds_filtered_per_frame"), (double)state_tracking_filtered));
+}
+
+/*
+ * Variants of render_pass: a render pass instance per draw, as in
+ * primary_single, or one around every draw, each with the load and store
+ * ops applied to the color and depth attachments
+ */
+struct render_pass_variant {
+  bool pass_per_draw;
+  VkAttachmentLoadOp load_op;
+  VkAttachmentStoreOp store_op;
+};
+static const char *const render_pass_variants[] = {"per_draw_clear_store",   "per_draw_load_store",
+                                                   "one_pass_clear_store",   "one_pass_load_store",
+                                                   "one_pass_dont_care_store", "one_pass_clear_dont_care", NULL};
+static const render_pass_variant render_pass_variant_ops[] = {
+  {true, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE},
+  {true, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_STORE},
+  {false, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE},
+  {false, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_STORE},
+  {false, VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_STORE},
+  {false, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE},
+};
+static VkRenderPass render_pass_ops_pass;
+static latency_histogram render_pass_record_times;
+
+/*
+ * Load and store ops are not part of render pass compatibility, so the
+ * variant's render pass is used with the sample's framebuffers and pipeline
+ */
+void renderPassBenchmarkBegin(sample_info &info, VkClearValue *clear_values)
+{
+  const render_pass_variant &variant = render_pass_variant_ops[benchmark_variant];
+  VkRenderPass sample_render_pass = info.render_pass;
+  init_renderpass_ops(info, info.depth.view != VK_NULL_HANDLE, variant.load_op, variant.store_op);
+  render_pass_ops_pass = info.render_pass;
+  info.render_pass = sample_render_pass;
+  init_latency_histogram(render_pass_record_times);
+}
+
+/*
+ * Every variant binds and draws the same way for each draw, so the per_draw
+ * and one_pass variants differ only in their render pass instances.  A LOAD
+ * from the attachments' UNDEFINED initial layout still pays for the load,
+ * while only giving back undefined contents.
+ */
+void renderPassCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+  frame_slot &slot = info.frames_in_flight[info.current_frame];
+  const render_pass_variant &variant = render_pass_variant_ops[benchmark_variant];
+
+  VkRenderPassBeginInfo rp_begin;
+  init_render_pass_begin_info(info, rp_begin);
+  rp_begin.renderPass = render_pass_ops_pass;
+  rp_begin.clearValueCount = 2;
+  rp_begin.pClearValues = clear_values;
+
+  VkCommandBufferBeginInfo cmd_buf_info = {};
+  cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  cmd_buf_info.pNext = NULL;
+  cmd_buf_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  cmd_buf_info.pInheritanceInfo = NULL;
+
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_RECORD);
+  uint64_t record_start_ns = benchmark_timestamp_ns();
+  vkBeginCommandBuffer(slot.cmd, &cmd_buf_info);
+  execute_begin_timestamp_query(info, slot.cmd);
+  execute_begin_pipeline_statistics_query(info, slot.cmd, 0);
+  if (!variant.pass_per_draw) vkCmdBeginRenderPass(slot.cmd, &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
+  for (uint32_t x = 0; x < info.benchmark_draws; x++) {
+    if (variant.pass_per_draw) vkCmdBeginRenderPass(slot.cmd, &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
+    record_benchmark_draw(info, slot.cmd);
+    if (variant.pass_per_draw) vkCmdEndRenderPass(slot.cmd);
+  }
+  if (!variant.pass_per_draw) vkCmdEndRenderPass(slot.cmd);
+  execute_end_pipeline_statistics_query(info, slot.cmd, 0);
+  execute_end_timestamp_query(info, slot.cmd);
+  res = vkEndCommandBuffer(slot.cmd);
+  assert(res == VK_SUCCESS);
+  if (benchmark_phases_active()) {
+    latency_histogram_record(render_pass_record_times, benchmark_timestamp_ns() - record_start_ns);
+  }
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_RECORD);
+
+  submit_and_present(info, &slot.cmd, 1);
+}
+
+void renderPassBenchmarkEnd(sample_info &info, benchmark_metrics &metrics)
+{
+  const render_pass_variant &variant = render_pass_variant_ops[benchmark_variant];
+  append_latency_metrics(render_pass_record_times, "record", metrics);
+  metrics.push_back(std::make_pair(std::string("render_passes_per_frame"),
+                                   (double)(variant.pass_per_draw ? info.benchmark_draws : 1)));
+
+  vkDestroyRenderPass(info.device, render_pass_ops_pass, NULL);
+  render_pass_ops_pass = VK_NULL_HANDLE;
+}
+
+/*
+ * Variants of uniform_update: the frame's slot of a uniform ring is written
+ * once per frame, mapping and unmapping it around the copy or through the
+ * mapping init_uniform_ring() keeps
+ */
+enum uniform_update_mode {
+  UNIFORM_MAP_UNMAP,
+  UNIFORM_PERSISTENT,
+};
+static const char *const uniform_update_variants[] = {"map_unmap", "persistent", NULL};
+static benchmark_pipeline uniform_update_pipeline;
+static uniform_ring uniform_update_ring;
+static VkDescriptorPool uniform_update_pool;
+static VkDescriptorSet uniform_update_set;
+static std::vector<uint8_t> uniform_update_data;
+static latency_histogram uniform_update_times;
+static latency_histogram uniform_update_record_times;
+
+/*
+ * map_unmap's write, its ring has memory of its own because sub-allocated
+ * blocks stay mapped and memory can only be mapped once at a time
+ */
+static uint32_t write_uniform_update_slot(sample_info &info, uint32_t slot)
+{
+  if (benchmark_variant != UNIFORM_MAP_UNMAP) {
+    return write_uniform_ring(info, uniform_update_ring, slot, uniform_update_data.data());
+  }
+
+  VkResult U_ASSERT_ONLY res;
+  const VkDeviceSize offset = slot * uniform_update_ring.stride;
+  uint8_t *data;
+  res = vkMapMemory(info.device, uniform_update_ring.mem.memory, uniform_update_ring.mem.offset + offset,
+                    uniform_update_ring.stride, 0, (void **)&data);
+  assert(res == VK_SUCCESS);
+  memcpy(data, uniform_update_data.data(), uniform_update_data.size());
+  if (!uniform_update_ring.coherent) {
+    VkMappedMemoryRange flush_range = {};
+    flush_range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    flush_range.pNext = NULL;
+    flush_range.memory = uniform_update_ring.mem.memory;
+    flush_range.offset = uniform_update_ring.mem.offset + offset;
+    flush_range.size = uniform_update_ring.stride;
+    res = vkFlushMappedMemoryRanges(info.device, 1, &flush_range);
+    assert(res == VK_SUCCESS);
+  }
+  vkUnmapMemory(info.device, uniform_update_ring.mem.memory);
+  return (uint32_t)offset;
+}
+
+/*
+ * One ring slot per frame in flight, filled with the sample's uniform data
+ * and bound through a single dynamic descriptor
+ */
+void uniformUpdateBenchmarkBegin(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+  const bool texture = benchmark_sample_has_texture(info);
+  const VkDeviceSize range = info.uniform_data.buffer_info.range;
+
+  init_benchmark_pipeline(info, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 0, uniform_update_pipeline);
+  init_uniform_ring(info, uniform_update_ring, range, info.frames_in_flight.size(),
+                    benchmark_variant == UNIFORM_MAP_UNMAP);
+
+  // The sample's uniform ring is always host visible and mapped, every slot holds the same data
+  const uint8_t *sample_data = info.uniform_data.mapped;
+  uniform_update_data.assign(sample_data, sample_data + range);
+
+  for (uint32_t x = 0; x < uniform_update_ring.slot_count; x++) write_uniform_update_slot(info, x);
+
+  VkDescriptorPoolSize type_count[2];
+  type_count[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+  type_count[0].descriptorCount = 1;
+  type_count[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  type_count[1].descriptorCount = 1;
+
+  VkDescriptorPoolCreateInfo descriptor_pool = {};
+  descriptor_pool.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptor_pool.pNext = NULL;
+  descriptor_pool.maxSets = 1;
+  descriptor_pool.poolSizeCount = texture ? 2 : 1;
+  descriptor_pool.pPoolSizes = type_count;
+  res = vkCreateDescriptorPool(info.device, &descriptor_pool, NULL, &uniform_update_pool);
+  assert(res == VK_SUCCESS);
+
+  VkDescriptorSetAllocateInfo set_alloc_info = {};
+  set_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  set_alloc_info.pNext = NULL;
+  set_alloc_info.descriptorPool = uniform_update_pool;
+  set_alloc_info.descriptorSetCount = 1;
+  set_alloc_info.pSetLayouts = &uniform_update_pipeline.desc_layout;
+  res = vkAllocateDescriptorSets(info.device, &set_alloc_info, &uniform_update_set);
+  assert(res == VK_SUCCESS);
+
+  VkWriteDescriptorSet writes[2] = {};
+  writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writes[0].pNext = NULL;
+  writes[0].dstSet = uniform_update_set;
+  writes[0].dstBinding = 0;
+  writes[0].dstArrayElement = 0;
+  writes[0].descriptorCount = 1;
+  writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+  writes[0].pBufferInfo = &uniform_update_ring.buffer_info;
+  writes[1] = writes[0];
+  writes[1].dstBinding = 1;
+  writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  writes[1].pBufferInfo = NULL;
+  writes[1].pImageInfo = &info.texture_data.image_info;
+  vkUpdateDescriptorSets(info.device, texture ? 2 : 1, writes, 0, NULL);
+
+  init_latency_histogram(uniform_update_times);
+  init_latency_histogram(uniform_update_record_times);
+}
+
+/*
+ * The slot's fence has been waited on, so the frame can overwrite its slot
+ * while the frames before it still read theirs.  Every draw then reads the
+ * frame's slot in one render pass.
+ */
+void uniformUpdateCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+  frame_slot &slot = info.frames_in_flight[info.current_frame];
+
+  uint64_t update_start_ns = benchmark_timestamp_ns();
+  uint32_t offset = write_uniform_update_slot(info, info.current_frame);
+  if (benchmark_phases_active()) {
+    latency_histogram_record(uniform_update_times, benchmark_timestamp_ns() - update_start_ns);
+  }
+
+  VkRenderPassBeginInfo rp_begin;
+  init_render_pass_begin_info(info, rp_begin);
+  rp_begin.clearValueCount = 2;
+  rp_begin.pClearValues = clear_values;
+
+  VkCommandBufferBeginInfo cmd_buf_info = {};
+  cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  cmd_buf_info.pNext = NULL;
+  cmd_buf_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  cmd_buf_info.pInheritanceInfo = NULL;
+
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_RECORD);
+  uint64_t record_start_ns = benchmark_timestamp_ns();
+  vkBeginCommandBuffer(slot.cmd, &cmd_buf_info);
+  execute_begin_timestamp_query(info, slot.cmd);
+  execute_begin_pipeline_statistics_query(info, slot.cmd, 0);
+  vkCmdBeginRenderPass(slot.cmd, &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
+  vkCmdBindPipeline(slot.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, uniform_update_pipeline.pipeline);
+  record_benchmark_vertex_state(info, slot.cmd);
+  vkCmdBindDescriptorSets(slot.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, uniform_update_pipeline.pipeline_layout, 0, 1,
+                          &uniform_update_set, 1, &offset);
+  for (uint32_t x = 0; x < info.benchmark_draws; x++) vkCmdDraw(slot.cmd, info.vertex_count, 1, 0, 0);
+  vkCmdEndRenderPass(slot.cmd);
+  execute_end_pipeline_statistics_query(info, slot.cmd, 0);
+  execute_end_timestamp_query(info, slot.cmd);
+  res = vkEndCommandBuffer(slot.cmd);
+  assert(res == VK_SUCCESS);
+  if (benchmark_phases_active()) {
+    latency_histogram_record(uniform_update_record_times, benchmark_timestamp_ns() - record_start_ns);
+  }
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_RECORD);
+
+  submit_and_present(info, &slot.cmd, 1);
+}
+
+void uniformUpdateBenchmarkEnd(sample_info &info, benchmark_metrics &metrics)
+{
+  append_latency_metrics(uniform_update_times, "update", metrics);
+  append_latency_metrics(uniform_update_record_times, "record", metrics);
+  metrics.push_back(std::make_pair(std::string("uniform_coherent"), uniform_update_ring.coherent ? 1.0 : 0.0));
+  metrics.push_back(std::make_pair(std::string("uniform_stride"), (double)uniform_update_ring.stride));
+
+  vkDestroyDescriptorPool(info.device, uniform_update_pool, NULL);
+  destroy_uniform_ring(info, uniform_update_ring);
+  uniform_update_data.clear();
+  destroy_benchmark_pipeline(info, uniform_update_pipeline);
+}
+
+/*
+ * Variants of vertex_placement: the copy of the sample's vertices every draw
+ * reads is in host visible memory, where the vertex fetch crosses the bus on
+ * discrete GPUs, or in device local memory
+ */
+static const char *const vertex_placement_variants[] = {"host_visible", "device_local", NULL};
+static const VkMemoryPropertyFlags vertex_placement_memory[] = {
+  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT};
+static VkBuffer vertex_placement_buffer;
+static device_allocation vertex_placement_memory_object;
+static latency_histogram vertex_placement_record_times;
+
+/*
+ * The copy comes from the sample's vertex buffer on the graphics queue, so
+ * it works whatever memory --device-local-buffers put that in
+ */
+void vertexPlacementBenchmarkBegin(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+  bool U_ASSERT_ONLY pass;
+  const VkDeviceSize size = (VkDeviceSize)info.vertex_count * info.vi_binding.stride;
+
+  VkBufferCreateInfo buf_info = {};
+  buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  buf_info.pNext = NULL;
+  buf_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  buf_info.size = size;
+  buf_info.queueFamilyIndexCount = 0;
+  buf_info.pQueueFamilyIndices = NULL;
+  buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  buf_info.flags = 0;
+  res = vkCreateBuffer(info.device, &buf_info, NULL, &vertex_placement_buffer);
+  assert(res == VK_SUCCESS);
+
+  // Only the memory type matters to the comparison, so the copy can share a block
+  pass = device_alloc_buffer(info, vertex_placement_buffer, vertex_placement_memory[benchmark_variant],
+                             vertex_placement_memory_object);
+  assert(pass && "No memory type for the variant");
+
+  execute_copy_buffer(info, info.vertex_buffer.buf, vertex_placement_buffer, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                      false);
+
+  init_latency_histogram(vertex_placement_record_times);
+}
+
+/*
+ * Unlike the other scenarios every draw fetches all of the sample's
+ * vertices, so the GPU frame time follows where they live
+ */
+void vertexPlacementCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values)
+{
+  VkResult U_ASSERT_ONLY res;
+  frame_slot &slot = info.frames_in_flight[info.current_frame];
+  const VkDeviceSize offsets[1] = {0};
+
+  VkRenderPassBeginInfo rp_begin;
+  init_render_pass_begin_info(info, rp_begin);
+  rp_begin.clearValueCount = 2;
+  rp_begin.pClearValues = clear_values;
+
+  VkCommandBufferBeginInfo cmd_buf_info = {};
+  cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  cmd_buf_info.pNext = NULL;
+  cmd_buf_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  cmd_buf_info.pInheritanceInfo = NULL;
+
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_RECORD);
+  uint64_t record_start_ns = benchmark_timestamp_ns();
+  vkBeginCommandBuffer(slot.cmd, &cmd_buf_info);
+  execute_begin_timestamp_query(info, slot.cmd);
+  execute_begin_pipeline_statistics_query(info, slot.cmd, 0);
+  vkCmdBeginRenderPass(slot.cmd, &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
+  record_benchmark_state(info, slot.cmd);
+  vkCmdBindVertexBuffers(slot.cmd, 0, 1, &vertex_placement_buffer, offsets);
+  for (uint32_t x = 0; x < info.benchmark_draws; x++) vkCmdDraw(slot.cmd, info.vertex_count, 1, 0, 0);
+  vkCmdEndRenderPass(slot.cmd);
+  execute_end_pipeline_statistics_query(info, slot.cmd, 0);
+  execute_end_timestamp_query(info, slot.cmd);
+  res = vkEndCommandBuffer(slot.cmd);
+  assert(res == VK_SUCCESS);
+  if (benchmark_phases_active()) {
+    latency_histogram_record(vertex_placement_record_times, benchmark_timestamp_ns() - record_start_ns);
+  }
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_RECORD);
+
+  submit_and_present(info, &slot.cmd, 1);
+}
+
+void vertexPlacementBenchmarkEnd(sample_info &info, benchmark_metrics &metrics)
+{
+  append_latency_metrics(vertex_placement_record_times, "record", metrics);
+  metrics.push_back(std::make_pair(std::string("vertices_per_frame"),
+                                   (double)info.vertex_count * info.benchmark_draws));
+  metrics.push_back(std::make_pair(std::string("transfer_queue"), info.transfer_queue != VK_NULL_HANDLE ? 1.0 : 0.0));
+
+  vkDestroyBuffer(info.device, vertex_placement_buffer, NULL);
+  device_free(info, vertex_placement_memory_object);
+}
+
+static const benchmark_scenario benchmark_scenarios[] = {
+  {"primary", "one primary command buffer per draw, all submitted together", primaryCommandBufferBenchmark, false, NULL,
+   NULL, NULL, NULL},
+  {"primary_single", "one primary command buffer holding every render pass", primaryCommandBufferBenchmark2, false, NULL,
+   NULL, NULL, NULL},
+  {"secondary", "one secondary command buffer per draw, executed from a primary", secondaryCommandBufferBenchmark, false,
+   NULL, NULL, NULL, NULL},
+  {"primary_threaded", "one primary command buffer per draw, recorded by a pool of threads",
+   threadedPrimaryCommandBufferBenchmark, true, NULL, NULL, NULL, NULL},
+  {"secondary_threaded", "secondaries recorded by a pool of threads, executed from one primary per frame",
+   threadedSecondaryCommandBufferBenchmark, true, secondary_threaded_variants, NULL, NULL, NULL},
+  {"primary_prebaked", "primaries recorded once per swapchain image before the run, only resubmitted each frame",
+   prebakedCommandBufferBenchmark, false, prebaked_variants, prebakedBenchmarkBegin, prebakedBenchmarkEnd, NULL},
+  {"pool_reset", "one primary command buffer per draw from a pool per frame, reset the variant's way",
+   poolResetCommandBufferBenchmark, false, pool_reset_variants, poolResetBenchmarkBegin, poolResetBenchmarkEnd, NULL},
+  {"submit_batching", "one primary command buffer per draw, grouped into submit infos and vkQueueSubmit calls",
+   submitBatchingCommandBufferBenchmark, false, submit_batching_variants, submitBatchingBenchmarkBegin,
+   submitBatchingBenchmarkEnd, NULL},
+  {"indirect", "every draw in one render pass, issued directly or from a buffer of indirect draw commands",
+   indirectCommandBufferBenchmark, false, indirect_variants, indirectBenchmarkBegin, indirectBenchmarkEnd,
+   indirectBenchmarkSupported},
+  {"instanced", "the sample's instances drawn in one render pass, one draw each or all in one instanced draw",
+   instancedCommandBufferBenchmark, false, instanced_variants, instancedBenchmarkBegin, instancedBenchmarkEnd,
+   instancedBenchmarkSupported},
+  {"uniform_per_draw", "every draw in one render pass with uniform data of its own, bound or pushed before it",
+   uniformPerDrawCommandBufferBenchmark, false, uniform_per_draw_variants, uniformPerDrawBenchmarkBegin,
+   uniformPerDrawBenchmarkEnd, uniformPerDrawBenchmarkSupported},
+  {"state_tracking", "a render pass per draw with the binds going through a recorder that can drop redundant ones",
+   stateTrackingCommandBufferBenchmark, false, state_tracking_variants, stateTrackingBenchmarkBegin,
+   stateTrackingBenchmarkEnd, NULL},
+  {"render_pass", "every draw in a render pass of its own or all in one, with the variant's load and store ops",
+   renderPassCommandBufferBenchmark, false, render_pass_variants, renderPassBenchmarkBegin, renderPassBenchmarkEnd,
+   NULL},
+  {"uniform_update", "the frame's uniform data written once before its draws, mapping the buffer each time or not",
+   uniformUpdateCommandBufferBenchmark, false, uniform_update_variants, uniformUpdateBenchmarkBegin,
+   uniformUpdateBenchmarkEnd, NULL},
+  {"vertex_placement", "every draw in one render pass reading a copy of the sample's vertices in the variant's memory",
+   vertexPlacementCommandBufferBenchmark, false, vertex_placement_variants, vertexPlacementBenchmarkBegin,
+   vertexPlacementBenchmarkEnd, NULL},
+};
+
+uint32_t get_benchmark_scenario_count()
+{
+  return sizeof(benchmark_scenarios) / sizeof(benchmark_scenarios[0]);
+}
+
+const benchmark_scenario *get_benchmark_scenario(uint32_t index)
+{
+  return index < get_benchmark_scenario_count() ? &benchmark_scenarios[index] : NULL;
+}
+
+const benchmark_scenario *find_benchmark_scenario(const char *name)
+{
+  for (uint32_t i = 0; i < get_benchmark_scenario_count(); i++) {
+    if (strcmp(benchmark_scenarios[i].name, name) == 0) return &benchmark_scenarios[i];
+  }
+  return NULL;
+}
+
+void print_benchmark_scenarios()
+{
+  printf("\nBenchmark scenarios:\n");
+  for (uint32_t i = 0; i < get_benchmark_scenario_count(); i++) {
+    printf("\t%s\n\t\t%s\n", benchmark_scenarios[i].name, benchmark_scenarios[i].description);
+    const char *const *variants = benchmark_scenarios[i].variants;
+    if (variants) {
+      printf("\t\tvariants:");
+      for (uint32_t v = 0; variants[v]; v++) printf(" %s", variants[v]);
+      printf("\n");
+    }
+  }
+  printf("\tall\n\t\trun every scenario above in turn\n");
+}
+
+/*
+ * Reads back the GPU time of the frame that last wrote query slot.  Only the
+ * end of a run waits, every other read skips a frame that is still running.
+ */
+static void collect_gpu_frame_time(sample_info &info, uint32_t slot, bool wait, latency_histogram *gpu_times)
+{
+  uint64_t gpu_time_ns;
+  if (execute_read_timestamp_query(info, slot, wait, gpu_time_ns) && gpu_times) {
+    latency_histogram_record(*gpu_times, gpu_time_ns);
+  }
+}
+
+/*
+ * Waits for the frame that last used this frame's slot, so that its command
+ * buffers, semaphores and queries can be reused, then records and submits.
+ */
+static void execute_benchmark_frame(sample_info &info, const benchmark_scenario &scenario, int frame,
+                                    VkClearValue *clear_values, latency_histogram *gpu_times)
+{
+  VkResult U_ASSERT_ONLY res;
+
+  info.current_frame = frame % info.frames_in_flight.size();
+  frame_slot &slot = info.frames_in_flight[info.current_frame];
+
+  BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_WAIT);
+  do {
+    res = vkWaitForFences(info.device, 1, &slot.fence, VK_TRUE, FENCE_TIMEOUT);
+  } while (res == VK_TIMEOUT);
+  BENCHMARK_PHASE_END(BENCHMARK_PHASE_WAIT);
+  assert(res == VK_SUCCESS);
+  res = vkResetFences(info.device, 1, &slot.fence);
+  assert(res == VK_SUCCESS);
+
+  // The slot's fence covers its timestamps too, so this read never blocks
+  if (info.timestamps.slot_count) collect_gpu_frame_time(info, info.current_frame, false, gpu_times);
+
+  info.current_buffer = frame % info.swapchainImageCount;
+  if (info.swap_chain != VK_NULL_HANDLE) {
+    // Get the index of the next available swapchain image:
+    BENCHMARK_PHASE_BEGIN(BENCHMARK_PHASE_ACQUIRE);
+    res = vkAcquireNextImageKHR(info.device,
+                                info.swap_chain,
+                                UINT64_MAX,
+                                slot.image_acquired,
+                                VK_NULL_HANDLE,
+                                &info.current_buffer);
+    BENCHMARK_PHASE_END(BENCHMARK_PHASE_ACQUIRE);
+    // TODO: Deal with the VK_SUBOPTIMAL_KHR and VK_ERROR_OUT_OF_DATE_KHR
+    // return codes
+    assert(res == VK_SUCCESS);
+  }
+  scenario.frame(info, clear_values);
+}
+
+/*
+ * threads is only used by threaded scenarios.  Returns their mean recording
+ * time per frame, so a sweep can report its speedup over the first run.
+ */
+static double execute_benchmark(sample_info &info, const char *sample_name, const benchmark_scenario &scenario,
+                                uint32_t threads, double single_thread_record_ns, VkClearValue *clear_values)
+{
+  info.pipeline_stats_query_count = 0;
+  if (scenario.threaded) {
+    init_benchmark_workers(info, benchmark_workers, threads, info.frames_in_flight.size());
+    init_latency_histogram(threaded_record_times);
+    init_latency_histogram(threaded_execute_times);
+  }
+  if (scenario.begin) scenario.begin(info, clear_values);
+  for (int x = 0; x < info.benchmark_warmup; x++) {
+    execute_benchmark_frame(info, scenario, x, clear_values, NULL);
+  }
+  // Drop the warmup frames' GPU times
+  execute_wait_frames_in_flight(info);
+  for (uint32_t i = 0; i < info.timestamps.slot_count; i++) collect_gpu_frame_time(info, i, true, NULL);
+
+  latency_histogram frame_times;
+  init_latency_histogram(frame_times);
+  latency_histogram gpu_times;
+  init_latency_histogram(gpu_times);
+  uint32_t warmup_steals = scenario.threaded ? get_benchmark_worker_steals(benchmark_workers) : 0;
+
+  start_benchmark_phases();
+  auto start = std::chrono::high_resolution_clock::now();
+  auto frame_start = start;
+  for (int x = 0; x < info.benchmark_frames; x++) {
+    execute_benchmark_frame(info, scenario, x, clear_values, &gpu_times);
+    auto frame_end = std::chrono::high_resolution_clock::now();
+    latency_histogram_record(frame_times, std::chrono::duration_cast<std::chrono::nanoseconds>(frame_end - frame_start).count());
+    frame_start = frame_end;
+  }
+  // Frames still in flight are part of the run
+  execute_wait_frames_in_flight(info);
+  auto finish = std::chrono::high_resolution_clock::now();
+  stop_benchmark_phases();
+  std::chrono::duration<double> elapsed = finish - start;
+  for (uint32_t i = 0; i < info.timestamps.slot_count; i++) collect_gpu_frame_time(info, i, true, &gpu_times);
+
+  benchmark_result result;
+  result.sample = sample_name;
+  result.scenario = scenario.name;
+  result.frames = info.benchmark_frames;
+  result.warmup = info.benchmark_warmup;
+  result.threads = scenario.threaded ? threads : 1;
+  result.threaded = scenario.threaded;
+  result.frames_in_flight = info.frames_in_flight.size();
+  result.draws = info.benchmark_draws;
+  if (scenario.variants) result.variant = scenario.variants[benchmark_variant];
+  result.metrics.push_back(std::make_pair(std::string("elapsed_s"), elapsed.count()));
+  append_latency_metrics(frame_times, "frame", result.metrics);
+  // Per draw costs, to plot against --draws
+  result.metrics.push_back(
+      std::make_pair(std::string("frame_per_draw_ns"), latency_histogram_mean(frame_times) / info.benchmark_draws));
+  append_benchmark_phase_metrics(result.metrics);
+  if (gpu_times.count) {
+    append_latency_metrics(gpu_times, "gpu_frame", result.metrics);
+    result.metrics.push_back(std::make_pair(std::string("gpu_busy_pct"), 100.0 * gpu_times.sum / frame_times.sum));
+    result.metrics.push_back(
+        std::make_pair(std::string("gpu_frame_per_draw_ns"), latency_histogram_mean(gpu_times) / info.benchmark_draws));
+  }
+
+  double record_ns = 0.0;
+  if (scenario.threaded) {
+    record_ns = latency_histogram_mean(threaded_record_times);
+    append_latency_metrics(threaded_record_times, "record", result.metrics);
+    result.metrics.push_back(
+        std::make_pair(std::string("record_draws_per_s"), record_ns > 0.0 ? info.benchmark_draws * 1e9 / record_ns : 0.0));
+    if (single_thread_record_ns > 0.0 && record_ns > 0.0) {
+      result.metrics.push_back(std::make_pair(std::string("record_speedup"), single_thread_record_ns / record_ns));
+    }
+    if (threaded_execute_times.count) append_latency_metrics(threaded_execute_times, "execute", result.metrics);
+    uint32_t steals = get_benchmark_worker_steals(benchmark_workers) - warmup_steals;
+    result.metrics.push_back(std::make_pair(std::string("steals_per_frame"),
+                                            info.benchmark_frames > 0 ? (double)steals / info.benchmark_frames : 0.0));
+    destroy_benchmark_workers(benchmark_workers);
+  }
+
+  // Before the scenario frees what it allocated, so its buffers are counted
+  append_device_allocator_metrics(result.metrics);
+  if (scenario.end) scenario.end(info, result.metrics);
+
+  // Every frame records the same work, so the last one stands for the run
+  uint64_t statistics[PIPELINE_STATISTICS_COUNT];
+  uint32_t last_frame = (info.benchmark_frames - 1) % info.frames_in_flight.size();
+  if (info.benchmark_frames > 0 &&
+      execute_read_pipeline_statistics(info, last_frame, info.pipeline_stats_query_count, statistics)) {
+    static const char *const statistic_names[PIPELINE_STATISTICS_COUNT] = {
+      "ia_vertices", "vs_invocations", "clipping_primitives", "fs_invocations",
+    };
+    for (uint32_t i = 0; i < PIPELINE_STATISTICS_COUNT; i++) {
+      result.metrics.push_back(std::make_pair(std::string(statistic_names[i]), (double)statistics[i]));
+    }
+  }
+  write_benchmark_result(info, result);
+  return record_ns;
+}
+
+/*
+ * Runs a threaded scenario for --threads, or for 1, 2, 4 ... threads up to
+ * the number of cores when it was not given.
+ */
+static void execute_thread_sweep(sample_info &info, const char *sample_name, const benchmark_scenario &scenario,
+                                 VkClearValue *clear_values)
+{
+  if (!scenario.threaded || info.benchmark_threads > 0) {
+    uint32_t threads = info.benchmark_threads > 0 ? info.benchmark_threads : 1;
+    execute_benchmark(info, sample_name, scenario, threads, 0.0, clear_values);
+    return;
+  }
+
+  uint32_t cores = get_benchmark_core_count();
+  double single_thread_record_ns = 0.0;
+  for (uint32_t threads = 1;; threads = threads * 2 < cores ? threads * 2 : cores) {
+    double record_ns = execute_benchmark(info, sample_name, scenario, threads, single_thread_record_ns, clear_values);
+    if (threads == 1) single_thread_record_ns = record_ns;
+    if (threads == cores) break;
+  }
+}
+
+/*
+ * Runs every variant of a scenario, or only --variant when it was given
+ */
+static void execute_benchmark_sweep(sample_info &info, const char *sample_name, const benchmark_scenario &scenario,
+                                    VkClearValue *clear_values)
+{
+  benchmark_variant = 0;
+  if (!scenario.variants) {
+    execute_thread_sweep(info, sample_name, scenario, clear_values);
+    return;
+  }
+
+  bool found = false;
+  for (benchmark_variant = 0; scenario.variants[benchmark_variant]; benchmark_variant++) {
+    if (!info.benchmark_variant.empty() && info.benchmark_variant != scenario.variants[benchmark_variant]) continue;
+    found = true;
+    if (scenario.supported && !scenario.supported(info)) {
+      printf("\n%s/%s is not supported by %s, skipped\n", scenario.name, scenario.variants[benchmark_variant],
+             sample_name);
+      continue;
+    }
+    execute_thread_sweep(info, sample_name, scenario, clear_values);
+  }
+  if (!found) printf("\n%s has no variant %s\n", scenario.name, info.benchmark_variant.c_str());
+}
+
+void execute_benchmarks(sample_info &info, const char *sample_name, const char *default_scenario,
+                        VkClearValue *clear_values)
+{
+  const char *name = info.benchmark_name.empty() ? default_scenario : info.benchmark_name.c_str();
+
+  const benchmark_scenario *scenario = NULL;
+  if (strcmp(name, "all") != 0) {
+    scenario = find_benchmark_scenario(name);
+    if (!scenario) {
+      printf("\nUnknown benchmark: %s\n", name);
+      print_benchmark_scenarios();
+      exit(-1);
+    }
+  }
+
+  uint32_t frame_count = info.benchmark_frames_in_flight > 0 ? info.benchmark_frames_in_flight : 1;
+  init_frames_in_flight(info, frame_count);
+  init_timestamp_queries(info, frame_count);
+  init_pipeline_statistics_queries(info, info.benchmark_draws, frame_count);
+  if (scenario) {
+    execute_benchmark_sweep(info, sample_name, *scenario, clear_values);
+  } else {
+    for (uint32_t i = 0; i < get_benchmark_scenario_count(); i++) {
+      execute_benchmark_sweep(info, sample_name, benchmark_scenarios[i], clear_values);
+    }
+  }
+  destroy_pipeline_statistics_queries(info);
+  destroy_timestamp_queries(info);
+  destroy_frames_in_flight(info);
+}
+
+void write_benchmark_result(sample_info &info, const benchmark_result &result)
+{
+  if (info.benchmark_format.empty() || info.benchmark_format == "text") {
+    std::string label = result.scenario;
+    if (!result.variant.empty()) label += "/" + result.variant;
+    if (result.threaded) label += " (" + std::to_string(result.threads) + " threads)";
+    for (size_t i = 0; i < result.metrics.size(); i++) {
+      if (result.metrics[i].first == "elapsed_s") {
+        std::cout << label << ": Elapsed time: " << result.metrics[i].second << " s\n";
+#ifdef __ANDROID__
+        LOGE("%s: Elapsed Time: %f", label.c_str(), result.metrics[i].second);
+#endif
+      } else {
+        std::cout << label << ": " << result.metrics[i].first << ": " << result.metrics[i].second << "\n";
+      }
+    }
+    return;
+  }
+
+  FILE *out = stdout;
+  if (!info.benchmark_output.empty()) {
+    // Append so that a sweep over several samples accumulates in one file
+    out = fopen(info.benchmark_output.c_str(), "a");
+    if (!out) {
+      printf("\nUnable to open %s for writing\n", info.benchmark_output.c_str());
+      return;
+    }
+  }
+
+  if (info.benchmark_format == "csv") {
+    // Only the first run written to a stream gets the header
+    static bool stdout_header_written = false;
+    bool write_header;
+    if (out == stdout) {
+      write_header = !stdout_header_written;
+      stdout_header_written = true;
+    } else {
+      fseek(out, 0, SEEK_END);
+      write_header = ftell(out) == 0;
+    }
+    if (write_header) fprintf(out, "sample,scenario,variant,frames,warmup,frames_in_flight,draws,threads,metric,value\n");
+    for (size_t i = 0; i < result.metrics.size(); i++) {
+      fprintf(out, "%s,%s,%s,%d,%d,%d,%u,%d,%s,%.9g\n", result.sample.c_str(), result.scenario.c_str(),
+              result.variant.c_str(), result.frames, result.warmup, result.frames_in_flight, result.draws,
+              result.threads, result.metrics[i].first.c_str(), result.metrics[i].second);
+    }
+  } else {
+    // One JSON object per line
+    fprintf(out,
+            "{\"sample\": \"%s\", \"scenario\": \"%s\", \"variant\": \"%s\", \"frames\": %d, \"warmup\": %d, "
+            "\"frames_in_flight\": %d, \"draws\": %u, \"threads\": %d, \"metrics\": {",
+            result.sample.c_str(), result.scenario.c_str(), result.variant.c_str(), result.frames, result.warmup,
+            result.frames_in_flight, result.draws, result.threads);
+    for (size_t i = 0; i < result.metrics.size(); i++) {
+      fprintf(out, "%s\"%s\": %.9g", i ? ", " : "", result.metrics[i].first.c_str(), result.metrics[i].second);
+    }
+    fprintf(out, "}}\n");
+  }
+
+  if (out != stdout) fclose(out);
 }
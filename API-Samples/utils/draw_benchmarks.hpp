@@ -0,0 +1,134 @@
+#ifndef DRAW_BENCHMARKS
+#define DRAW_BENCHMARKS
+
+#include <string>
+#include <vector>
+#include "util_init.hpp"
+#include "benchmark_stats.hpp"
+
+/* Default values for the benchmark driver options */
+#define BENCHMARK_DEFAULT_FRAMES 100
+#define BENCHMARK_DEFAULT_WARMUP 0
+
+/* Default for --frames-in-flight; 1 waits for each frame before the next */
+#define BENCHMARK_FRAMES_IN_FLIGHT 2
+
+/*
+ * Records, submits and presents one frame using the command buffers and
+ * semaphores of info.frames_in_flight[info.current_frame], whose previous
+ * frame has completed.  info.current_buffer has already been acquired with
+ * the slot's image_acquired semaphore unless the sample renders without a
+ * swapchain.
+ */
+typedef void (*benchmark_frame_func)(sample_info &info, VkClearValue *clear_values);
+
+/*
+ * Optional work done once per run outside the timed frames.  end is called
+ * after the last frame has completed and can add metrics to the run.
+ */
+typedef void (*benchmark_begin_func)(sample_info &info, VkClearValue *clear_values);
+typedef void (*benchmark_end_func)(sample_info &info, benchmark_metrics &metrics);
+
+/*
+ * Optional check of whether the sample has what the current variant needs,
+ * variants it fails are skipped
+ */
+typedef bool (*benchmark_supported_func)(sample_info &info);
+
+/*
+ * A named recording strategy selectable with --benchmark=<name>
+ */
+struct benchmark_scenario {
+  const char *name;
+  const char *description;
+  benchmark_frame_func frame;
+  bool threaded; // Records on a worker pool, run once per thread count
+  const char *const *variants; // NULL terminated, or NULL for a single variant
+  benchmark_begin_func begin;
+  benchmark_end_func end;
+  benchmark_supported_func supported;
+};
+
+/*
+ * Results of one scenario run, written by write_benchmark_result() in the
+ * format selected with --benchmark-format.
+ */
+struct benchmark_result {
+  std::string sample;
+  std::string scenario;
+  int frames;
+  int warmup;
+  int threads;
+  bool threaded;
+  std::string variant;
+  int frames_in_flight;
+  uint32_t draws;
+  benchmark_metrics metrics;
+};
+
+void primaryCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values);
+void primaryCommandBufferBenchmark2(sample_info &info, VkClearValue *clear_values);
+void secondaryCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values);
+void threadedPrimaryCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values);
+void threadedSecondaryCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values);
+void prebakedCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values);
+void prebakedBenchmarkBegin(sample_info &info, VkClearValue *clear_values);
+void prebakedBenchmarkEnd(sample_info &info, benchmark_metrics &metrics);
+void poolResetCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values);
+void poolResetBenchmarkBegin(sample_info &info, VkClearValue *clear_values);
+void poolResetBenchmarkEnd(sample_info &info, benchmark_metrics &metrics);
+void submitBatchingCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values);
+void submitBatchingBenchmarkBegin(sample_info &info, VkClearValue *clear_values);
+void submitBatchingBenchmarkEnd(sample_info &info, benchmark_metrics &metrics);
+void indirectCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values);
+void indirectBenchmarkBegin(sample_info &info, VkClearValue *clear_values);
+void indirectBenchmarkEnd(sample_info &info, benchmark_metrics &metrics);
+bool indirectBenchmarkSupported(sample_info &info);
+void instancedCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values);
+void instancedBenchmarkBegin(sample_info &info, VkClearValue *clear_values);
+void instancedBenchmarkEnd(sample_info &info, benchmark_metrics &metrics);
+bool instancedBenchmarkSupported(sample_info &info);
+void uniformPerDrawCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values);
+void uniformPerDrawBenchmarkBegin(sample_info &info, VkClearValue *clear_values);
+void uniformPerDrawBenchmarkEnd(sample_info &info, benchmark_metrics &metrics);
+bool uniformPerDrawBenchmarkSupported(sample_info &info);
+void stateTrackingCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values);
+void stateTrackingBenchmarkBegin(sample_info &info, VkClearValue *clear_values);
+void stateTrackingBenchmarkEnd(sample_info &info, benchmark_metrics &metrics);
+void renderPassCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values);
+void renderPassBenchmarkBegin(sample_info &info, VkClearValue *clear_values);
+void renderPassBenchmarkEnd(sample_info &info, benchmark_metrics &metrics);
+void uniformUpdateCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values);
+void uniformUpdateBenchmarkBegin(sample_info &info, VkClearValue *clear_values);
+void uniformUpdateBenchmarkEnd(sample_info &info, benchmark_metrics &metrics);
+void vertexPlacementCommandBufferBenchmark(sample_info &info, VkClearValue *clear_values);
+void vertexPlacementBenchmarkBegin(sample_info &info, VkClearValue *clear_values);
+void vertexPlacementBenchmarkEnd(sample_info &info, benchmark_metrics &metrics);
+
+uint32_t get_benchmark_scenario_count();
+const benchmark_scenario *get_benchmark_scenario(uint32_t index);
+const benchmark_scenario *find_benchmark_scenario(const char *name);
+void print_benchmark_scenarios();
+
+/*
+ * Runs the scenarios selected on the command line (or default_scenario when
+ * --benchmark was not given) for info.benchmark_warmup untimed frames
+ * followed by info.benchmark_frames timed frames, and reports each run.
+ * Every timed frame goes into a latency histogram so the tail is reported
+ * along with the total.  When the graphics queue supports timestamps the GPU
+ * time of each frame is reported next to it as gpu_frame_*, and
+ * gpu_busy_pct close to 100 means the run was GPU bound.  With
+ * --pipeline-stats the vertices, clipped primitives and shader invocations of
+ * the last frame are reported as well.  Threaded scenarios run once for
+ * --threads, or for 1, 2, 4 ... up to every core, and also report their
+ * recording time and its speedup over one thread.  Scenarios with variants
+ * run each of them in turn unless --variant picks one.  Up to
+ * --frames-in-flight frames are queued at once, each with its own fence,
+ * semaphores and command buffers, so the CPU records the next frame while
+ * the GPU renders the last.
+ */
+void execute_benchmarks(sample_info &info, const char *sample_name, const char *default_scenario,
+                        VkClearValue *clear_values);
+void write_benchmark_result(sample_info &info, const benchmark_result &result);
+
+#endif // DRAW_BENCHMARKS
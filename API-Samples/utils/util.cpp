@@ -32,6 +32,9 @@ samples utility functions
 #include <fstream>
 #include <iostream>
 #include "util.hpp"
+#include "draw_benchmarks.hpp"
+#include "benchmark_trace.hpp"
+#include "device_allocator.hpp"
 
 #ifdef __ANDROID__
 // Android specific include files.
@@ -573,15 +576,91 @@ static bool optionMatch(const char *option, char *optionLine) {
 void process_command_line_args(struct sample_info &info, int argc, char *argv[]) {
     int i, n;
 
+    info.benchmark_frames = BENCHMARK_DEFAULT_FRAMES;
+    info.benchmark_warmup = BENCHMARK_DEFAULT_WARMUP;
+    info.benchmark_draws = NUM_BUFFERS;
+    info.benchmark_frames_in_flight = BENCHMARK_FRAMES_IN_FLIGHT;
+
     for (i = 1, n = 1; i < argc; i++) {
         if (optionMatch("--save-images", argv[i]))
             info.save_images = true;
+        else if (optionMatch("--headless-surface", argv[i]))
+            info.headless_surface = true;
+        else if (optionMatch("--headless", argv[i]))
+            info.headless = true;
+        else if (optionMatch("--device-local-buffers", argv[i]))
+            info.device_local_buffers = true;
+        else if (optionMatch("--benchmark-format=", argv[i]))
+            info.benchmark_format = argv[i] + strlen("--benchmark-format=");
+        else if (optionMatch("--benchmark-output=", argv[i]))
+            info.benchmark_output = argv[i] + strlen("--benchmark-output=");
+        else if (optionMatch("--benchmark=", argv[i]))
+            info.benchmark_name = argv[i] + strlen("--benchmark=");
+        else if (optionMatch("--frames=", argv[i]))
+            info.benchmark_frames = atoi(argv[i] + strlen("--frames="));
+        else if (optionMatch("--warmup=", argv[i]))
+            info.benchmark_warmup = atoi(argv[i] + strlen("--warmup="));
+        else if (optionMatch("--draws=", argv[i]))
+            info.benchmark_draws = strtoul(argv[i] + strlen("--draws="), NULL, 10);
+        else if (optionMatch("--frames-in-flight=", argv[i]))
+            info.benchmark_frames_in_flight = atoi(argv[i] + strlen("--frames-in-flight="));
+        else if (optionMatch("--pipeline-stats", argv[i]))
+            info.benchmark_pipeline_stats = true;
+        else if (optionMatch("--threads=", argv[i]))
+            info.benchmark_threads = atoi(argv[i] + strlen("--threads="));
+        else if (optionMatch("--variant=", argv[i]))
+            info.benchmark_variant = argv[i] + strlen("--variant=");
+        else if (optionMatch("--trace=", argv[i]))
+            start_trace(argv[i] + strlen("--trace="));
         else if (optionMatch("--help", argv[i]) || optionMatch("-h", argv[i])) {
             printf("\nOther options:\n");
             printf(
                 "\t--save-images\n"
                 "\t\tSave tests images as ppm files in current working "
                 "directory.\n");
+            printf(
+                "\t--headless\n"
+                "\t\tRender to offscreen images without a window or\n"
+                "\t\tswapchain; nothing is presented.\n"
+                "\t--headless-surface\n"
+                "\t\tAcquire and present through a swapchain on a\n"
+                "\t\tVK_EXT_headless_surface surface instead of a window;\n"
+                "\t\tfalls back to --headless when it is not supported.\n"
+                "\t--device-local-buffers\n"
+                "\t\tUpload vertex data through a staging buffer into device\n"
+                "\t\tlocal memory, on a transfer-only queue when\n"
+                "\t\tthe device has one.\n");
+            printf(
+                "\t--benchmark=<name>\n"
+                "\t\tRecording strategy to run, or \"all\" to run each in turn.\n"
+                "\t--frames=<count>\n"
+                "\t\tNumber of timed frames per benchmark run (default %d).\n"
+                "\t--warmup=<count>\n"
+                "\t\tNumber of untimed frames before each run (default %d).\n"
+                "\t--draws=<count>\n"
+                "\t\tDraws, each in its own render pass, per benchmark frame\n"
+                "\t\t(default %d).\n"
+                "\t--frames-in-flight=<count>\n"
+                "\t\tFrames queued to the GPU before waiting on the oldest\n"
+                "\t\t(default %d, 1 waits for every frame).\n"
+                "\t--pipeline-stats\n"
+                "\t\tReport the vertices, primitives and shader invocations\n"
+                "\t\treaching the GPU in each benchmark frame.\n"
+                "\t--threads=<count>\n"
+                "\t\tRecording threads for the threaded scenarios (default:\n"
+                "\t\tsweep from 1 to the number of cores).\n"
+                "\t--variant=<name>\n"
+                "\t\tOnly run this variant of scenarios that have several.\n"
+                "\t--trace=<file>\n"
+                "\t\tWrite a Chrome trace (chrome://tracing or Perfetto) of\n"
+                "\t\tthe init calls, frame phases, submits and presents to\n"
+                "\t\tfile, when built with SAMPLES_TRACE.\n"
+                "\t--benchmark-format=<text|json|csv>\n"
+                "\t\tFormat of the per-run results (default text).\n"
+                "\t--benchmark-output=<file>\n"
+                "\t\tAppend json or csv results to file instead of stdout.\n",
+                BENCHMARK_DEFAULT_FRAMES, BENCHMARK_DEFAULT_WARMUP, NUM_BUFFERS, BENCHMARK_FRAMES_IN_FLIGHT);
+            print_benchmark_scenarios();
             exit(0);
         } else {
             printf("\nUnrecognized option: %s\n", argv[i]);
@@ -597,6 +676,20 @@ void process_command_line_args(struct sample_info &info, int argc, char *argv[])
         argv[n] = argv[i];
         n++;
     }
+
+    if (info.benchmark_draws == 0) {
+        printf("\n--draws must be at least 1\n");
+        exit(0);
+    }
+    if (info.benchmark_frames < 1) {
+        printf("\n--frames must be at least 1\n");
+        exit(0);
+    }
+    if (!info.benchmark_format.empty() && info.benchmark_format != "text" && info.benchmark_format != "json" &&
+        info.benchmark_format != "csv") {
+        printf("\n--benchmark-format must be text, json or csv\n");
+        exit(0);
+    }
 }
 
 void write_ppm(struct sample_info &info, const char *basename) {
@@ -623,38 +716,19 @@ void write_ppm(struct sample_info &info, const char *basename) {
     image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     image_create_info.flags = 0;
 
-    VkMemoryAllocateInfo mem_alloc = {};
-    mem_alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    mem_alloc.pNext = NULL;
-    mem_alloc.allocationSize = 0;
-    mem_alloc.memoryTypeIndex = 0;
-
     VkImage mappableImage;
-    VkDeviceMemory mappableMemory;
+    device_allocation mappableMemory;
 
     /* Create a mappable image */
     res = vkCreateImage(info.device, &image_create_info, NULL, &mappableImage);
     assert(res == VK_SUCCESS);
 
-    VkMemoryRequirements mem_reqs;
-    vkGetImageMemoryRequirements(info.device, mappableImage, &mem_reqs);
-
-    mem_alloc.allocationSize = mem_reqs.size;
-
-    /* Find the memory type that is host mappable */
-    bool pass = memory_type_from_properties(info, mem_reqs.memoryTypeBits,
-                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                            &mem_alloc.memoryTypeIndex);
+    /* Allocate and bind host mappable memory, it stays mapped */
+    bool U_ASSERT_ONLY pass = device_alloc_image(info, mappableImage, VK_IMAGE_TILING_LINEAR,
+                                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                 mappableMemory);
     assert(pass && "No mappable, coherent memory");
 
-    /* allocate memory */
-    res = vkAllocateMemory(info.device, &mem_alloc, NULL, &(mappableMemory));
-    assert(res == VK_SUCCESS);
-
-    /* bind memory */
-    res = vkBindImageMemory(info.device, mappableImage, mappableMemory, 0);
-    assert(res == VK_SUCCESS);
-
     VkCommandBufferBeginInfo cmd_buf_info = {};
     cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     cmd_buf_info.pNext = NULL;
@@ -665,7 +739,8 @@ void write_ppm(struct sample_info &info, const char *basename) {
     set_image_layout(info, mappableImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
 
-    set_image_layout(info, info.buffers[info.current_buffer].image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+    set_image_layout(info, info.buffers[info.current_buffer].image, VK_IMAGE_ASPECT_COLOR_BIT,
+                     info.headless ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
                      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
 
     VkImageCopy copy_region;
@@ -716,7 +791,10 @@ void write_ppm(struct sample_info &info, const char *basename) {
     submit_info[0].pSignalSemaphores = NULL;
 
     /* Queue the command buffer for execution */
-    res = vkQueueSubmit(info.graphics_queue, 1, submit_info, cmdFence);
+    {
+        TRACE_ZONE("queue", "vkQueueSubmit");
+        res = vkQueueSubmit(info.graphics_queue, 1, submit_info, cmdFence);
+    }
     assert(res == VK_SUCCESS);
 
     /* Make sure command buffer is finished before mapping */
@@ -737,11 +815,7 @@ void write_ppm(struct sample_info &info, const char *basename) {
     VkSubresourceLayout sr_layout;
     vkGetImageSubresourceLayout(info.device, mappableImage, &subres, &sr_layout);
 
-    char *ptr;
-    res = vkMapMemory(info.device, mappableMemory, 0, mem_reqs.size, 0, (void **)&ptr);
-    assert(res == VK_SUCCESS);
-
-    ptr += sr_layout.offset;
+    char *ptr = (char *)mappableMemory.mapped + sr_layout.offset;
     ofstream file(filename.c_str(), ios::binary);
 
     file << "P6\n";
@@ -773,9 +847,8 @@ void write_ppm(struct sample_info &info, const char *basename) {
     }
 
     file.close();
-    vkUnmapMemory(info.device, mappableMemory);
     vkDestroyImage(info.device, mappableImage, NULL);
-    vkFreeMemory(info.device, mappableMemory, NULL);
+    device_free(info, mappableMemory);
 }
 
 std::string get_file_directory() {
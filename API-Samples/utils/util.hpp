@@ -17,6 +17,9 @@
  * limitations under the License.
  */
 
+#ifndef UTIL_HPP
+#define UTIL_HPP
+
 #include <iostream>
 #include <string>
 #include <sstream>
@@ -53,6 +56,25 @@
 
 #include <vulkan/vulkan.h>
 
+/*
+ * VK_EXT_headless_surface is newer than some of the Vulkan headers these
+ * samples build against, declare what --headless-surface uses of it
+ */
+#ifndef VK_EXT_headless_surface
+#define VK_EXT_headless_surface 1
+#define VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME "VK_EXT_headless_surface"
+#define VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT ((VkStructureType)1000256000)
+typedef VkFlags VkHeadlessSurfaceCreateFlagsEXT;
+typedef struct VkHeadlessSurfaceCreateInfoEXT {
+    VkStructureType sType;
+    const void *pNext;
+    VkHeadlessSurfaceCreateFlagsEXT flags;
+} VkHeadlessSurfaceCreateInfoEXT;
+typedef VkResult(VKAPI_PTR *PFN_vkCreateHeadlessSurfaceEXT)(VkInstance instance,
+                                                            const VkHeadlessSurfaceCreateInfoEXT *pCreateInfo,
+                                                            const VkAllocationCallbacks *pAllocator, VkSurfaceKHR *pSurface);
+#endif
+
 /* Number of descriptor sets needs to be the same at alloc,       */
 /* pipeline layout creation, and descriptor set layout creation   */
 #define NUM_DESCRIPTOR_SETS 1
@@ -70,13 +92,25 @@
 /* Amount of time, in nanoseconds, to wait for a command buffer to complete */
 #define FENCE_TIMEOUT 100000000
 
-/* Number of command buffers that can be stored in the array */
+/* Statistics gathered by the pipeline statistics queries, in the order  */
+/* the results are written                                              */
+#define PIPELINE_STATISTICS_FLAGS                                              \
+    (VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |                 \
+     VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |               \
+     VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |                     \
+     VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT)
+#define PIPELINE_STATISTICS_COUNT 4
+
+/* Default number of draws, and command buffers, per benchmark frame, see --draws */
 #ifdef __ANDROID__
 #define NUM_BUFFERS 1000
 #else
 #define NUM_BUFFERS 10000
 #endif
 
+/* Offscreen images standing in for the swapchain with --headless */
+#define HEADLESS_IMAGE_COUNT 2
+
 #define GET_INSTANCE_PROC_ADDR(inst, entrypoint)                               \
     {                                                                          \
         info.fp##entrypoint =                                                  \
@@ -106,6 +140,21 @@
 std::string get_base_data_dir();
 std::string get_data_dir(std::string filename);
 
+/*
+ * A range of device memory handed out by device_alloc(), see
+ * device_allocator.hpp.  Resources bind at offset in memory, which other
+ * allocations share, so the memory must never be mapped or freed directly.
+ */
+struct device_allocation {
+    VkDeviceMemory memory; // VK_NULL_HANDLE when nothing is allocated
+    VkDeviceSize offset;
+    VkDeviceSize size;     // Bytes asked for
+    uint8_t *mapped;       // At offset, NULL unless the memory type is host visible
+    uint32_t pool;
+    uint32_t block;        // UINT32_MAX for an allocation with memory of its own
+    uint32_t size_class;
+};
+
 /*
  * structure to track all objects related to a texture.
  */
@@ -115,7 +164,7 @@ struct texture_object {
     VkImage image;
     VkImageLayout imageLayout;
 
-    VkDeviceMemory mem;
+    device_allocation mem;
     VkImageView view;
     int32_t tex_width, tex_height;
 };
@@ -127,7 +176,7 @@ struct texture_object {
 typedef struct _swap_chain_buffers {
     VkImage image;
     VkImageView view;
-    VkDeviceMemory mem;
+    device_allocation mem; // Headless images only
 } swap_chain_buffer;
 
 /*
@@ -140,6 +189,48 @@ typedef struct {
     std::vector<VkExtensionProperties> device_extensions;
 } layer_properties;
 
+/*
+ * Everything one frame in flight uses while the GPU may still be working on
+ * the frames before it, see init_frames_in_flight()
+ */
+typedef struct _frame_slot {
+    VkFence fence;               // Signaled once the frame's submit completes
+    VkSemaphore image_acquired;  // Signaled by vkAcquireNextImageKHR
+    VkSemaphore render_complete; // Signaled by the submit, waited on by the present
+    VkCommandBuffer cmd;
+    std::vector<VkCommandBuffer> cmds;
+    std::vector<VkCommandBuffer> cmd2s;
+} frame_slot;
+
+/*
+ * Ring of timestamp query pairs, one slot per frame in flight.  Each slot
+ * holds the GPU time at the start and at the end of one frame's render
+ * passes, see init_timestamp_queries().
+ */
+typedef struct _timestamp_query_ring {
+    VkQueryPool pool;
+    uint32_t slot_count;
+    std::vector<bool> pending; // Written by a recorded frame, not read back yet
+    float period;              // Nanoseconds per tick
+    uint64_t valid_mask;       // Bits of each timestamp written by the queue
+} timestamp_query_ring;
+
+/*
+ * Uniform buffer with one slot per frame in flight, kept mapped by the
+ * device allocator and written in place every frame.  Slots are bound with
+ * a dynamic offset, so a single descriptor covers all of them.
+ */
+typedef struct _uniform_ring {
+    VkBuffer buf;
+    device_allocation mem;
+    uint8_t *mapped;     // Whole buffer, NULL for a dedicated ring
+    bool coherent;       // False when writes need vkFlushMappedMemoryRanges
+    VkDeviceSize range;  // Bytes of uniform data in each slot
+    VkDeviceSize stride; // Slot size, aligned for dynamic offsets and flushes
+    uint32_t slot_count;
+    VkDescriptorBufferInfo buffer_info; // First slot, for a UNIFORM_BUFFER_DYNAMIC descriptor
+} uniform_ring;
+
 /*
  * Structure for tracking information used / created / modified
  * by utility functions.
@@ -168,9 +259,25 @@ struct sample_info {
     xcb_intern_atom_reply_t *atom_wm_delete_window;
 #endif // _WIN32
     VkSurfaceKHR surface;
+    PFN_vkCreateHeadlessSurfaceEXT fpCreateHeadlessSurfaceEXT;
     bool prepared;
     bool use_staging_buffer;
     bool save_images;
+    bool headless; // No window, surface or swapchain, see init_swap_chain()
+    bool headless_surface; // No window, a VK_EXT_headless_surface swapchain instead
+    bool device_local_buffers; // Vertex and uniform data staged into DEVICE_LOCAL memory
+
+    /* Benchmark driver options, see process_command_line_args() */
+    std::string benchmark_name;
+    std::string benchmark_format;
+    std::string benchmark_output;
+    int benchmark_frames;
+    int benchmark_warmup;
+    uint32_t benchmark_draws;
+    bool benchmark_pipeline_stats;
+    int benchmark_frames_in_flight;
+    int benchmark_threads;
+    std::string benchmark_variant;
 
     std::vector<const char *> instance_layer_names;
     std::vector<const char *> instance_extension_names;
@@ -184,8 +291,11 @@ struct sample_info {
     VkDevice device;
     VkQueue graphics_queue;
     VkQueue present_queue;
+    bool multi_draw_indirect; // multiDrawIndirect enabled by init_device()
     uint32_t graphics_queue_family_index;
     uint32_t present_queue_family_index;
+    VkQueue transfer_queue;               // VK_NULL_HANDLE without a transfer-only queue family
+    uint32_t transfer_queue_family_index; // UINT32_MAX without one, see init_device()
     VkPhysicalDeviceProperties gpu_props;
     std::vector<VkQueueFamilyProperties> queue_props;
     VkPhysicalDeviceMemoryProperties memory_properties;
@@ -205,31 +315,46 @@ struct sample_info {
         VkFormat format;
 
         VkImage image;
-        VkDeviceMemory mem;
+        device_allocation mem;
         VkImageView view;
     } depth;
 
     std::vector<struct texture_object> textures;
 
-    struct {
-        VkBuffer buf;
-        VkDeviceMemory mem;
-        VkDescriptorBufferInfo buffer_info;
-    } uniform_data;
+    uniform_ring uniform_data; // One slot per frame in flight, see init_uniform_buffer()
 
     struct {
         VkDescriptorImageInfo image_info;
     } texture_data;
-    VkDeviceMemory stagingMemory;
+    device_allocation stagingMemory;
     VkImage stagingImage;
 
     struct {
         VkBuffer buf;
-        VkDeviceMemory mem;
+        device_allocation mem;
         VkDescriptorBufferInfo buffer_info;
     } vertex_buffer;
+    /* Optional, for samples with indexed geometry */
+    struct {
+        VkBuffer buf;
+        device_allocation mem;
+        VkDescriptorBufferInfo buffer_info;
+    } index_buffer;
+    VkIndexType index_type;
+    uint32_t index_count;
     VkVertexInputBindingDescription vi_binding;
     VkVertexInputAttributeDescription vi_attribs[2];
+    uint32_t vertex_count; // Vertices in vertex_buffer, set by init_vertex_buffer()
+
+    /* Optional per-instance transforms, see init_instance_buffer() */
+    struct {
+        VkBuffer buf;
+        device_allocation mem;
+        VkDescriptorBufferInfo buffer_info;
+    } instance_buffer;
+    uint32_t instance_count;
+    VkVertexInputBindingDescription vi_instance_binding;
+    VkVertexInputAttributeDescription vi_instance_attribs[4]; // One per column of the mat4
 
     glm::mat4 Projection;
     glm::mat4 View;
@@ -239,8 +364,8 @@ struct sample_info {
 
     VkCommandBuffer cmd; // Buffer for initialization commands
     VkCommandBuffer cmd2; // Place to hold secondary command buffer
-    VkCommandBuffer cmds[NUM_BUFFERS]; // Place to hold a lot of buffers
-    VkCommandBuffer cmd2s[NUM_BUFFERS]; // Place to hold a lot of 2nd buffers
+    std::vector<VkCommandBuffer> cmds; // Place to hold a lot of buffers, benchmark_draws of them
+    std::vector<VkCommandBuffer> cmd2s; // Place to hold a lot of 2nd buffers, benchmark_draws of them
     VkPipelineLayout pipeline_layout;
     std::vector<VkDescriptorSetLayout> desc_layout;
     VkPipelineCache pipelineCache;
@@ -248,6 +373,7 @@ struct sample_info {
     VkPipeline pipeline;
 
     VkPipelineShaderStageCreateInfo shaderStages[2];
+    VkPipelineShaderStageCreateInfo push_constant_stage; // Optional, see init_push_constant_shader()
 
     VkDescriptorPool desc_pool;
     std::vector<VkDescriptorSet> desc_set;
@@ -262,6 +388,17 @@ struct sample_info {
 
     VkViewport viewport;
     VkRect2D scissor;
+
+    std::vector<frame_slot> frames_in_flight;
+    uint32_t current_frame; // Slot of frames_in_flight being recorded
+
+    timestamp_query_ring timestamps;
+
+    /* One pipeline statistics query per benchmark command buffer and frame in flight, */
+    /* see init_pipeline_statistics_queries()                                       */
+    VkQueryPool pipeline_stats_pool;
+    uint32_t pipeline_stats_queries_per_frame;
+    uint32_t pipeline_stats_query_count; // Queries used by the last submitted frame
 };
 void process_command_line_args(struct sample_info &info, int argc,
                                char *argv[]);
@@ -314,3 +451,5 @@ bool AndroidLoadFile(const char* filePath, std::string *data);
 #endif
 
 #endif
+
+#endif // UTIL_HPP
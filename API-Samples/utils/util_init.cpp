@@ -24,9 +24,12 @@ samples "init" utility functions
 */
 
 #include <cstdlib>
+#include <algorithm>
 #include <assert.h>
 #include <string.h>
 #include "util_init.hpp"
+#include "benchmark_trace.hpp"
+#include "device_allocator.hpp"
 #include "cube_data.h"
 #include <chrono>
 
@@ -40,6 +43,7 @@ using namespace std;
  * TODO: function description here
  */
 VkResult init_global_extension_properties(layer_properties &layer_props) {
+    TRACE_ZONE("init", __func__);
     VkExtensionProperties *instance_extensions;
     uint32_t instance_extension_count;
     VkResult res;
@@ -67,6 +71,7 @@ VkResult init_global_extension_properties(layer_properties &layer_props) {
  * TODO: function description here
  */
 VkResult init_global_layer_properties(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
     uint32_t instance_layer_count;
     VkLayerProperties *vk_props = NULL;
     VkResult res;
@@ -122,6 +127,7 @@ VkResult init_global_layer_properties(struct sample_info &info) {
 }
 
 VkResult init_device_extension_properties(struct sample_info &info, layer_properties &layer_props) {
+    TRACE_ZONE("init", __func__);
     VkExtensionProperties *device_extensions;
     uint32_t device_extension_count;
     VkResult res;
@@ -167,21 +173,46 @@ VkBool32 demo_check_layers(const std::vector<layer_properties> &layer_props, con
     return 1;
 }
 
+static bool instance_extension_supported(const char *extension_name) {
+    uint32_t count = 0;
+    VkResult res = vkEnumerateInstanceExtensionProperties(NULL, &count, NULL);
+    if (res != VK_SUCCESS) return false;
+    std::vector<VkExtensionProperties> extensions(count);
+    res = vkEnumerateInstanceExtensionProperties(NULL, &count, extensions.data());
+    if (res != VK_SUCCESS && res != VK_INCOMPLETE) return false;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!strcmp(extensions[i].extensionName, extension_name)) return true;
+    }
+    return false;
+}
+
 void init_instance_extension_names(struct sample_info &info) {
-    info.instance_extension_names.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+    if (info.headless_surface && !instance_extension_supported(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME)) {
+        std::cout << VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME " is not supported, rendering offscreen as with --headless\n";
+        info.headless_surface = false;
+        info.headless = true;
+    }
+
+    /* A headless run has no surface, so needs no WSI extensions */
+    if (info.headless_surface) {
+        info.instance_extension_names.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+        info.instance_extension_names.push_back(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+    } else if (!info.headless) {
+        info.instance_extension_names.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
 #ifdef __ANDROID__
-    info.instance_extension_names.push_back(VK_KHR_ANDROID_SURFACE_EXTENSION_NAME);
+        info.instance_extension_names.push_back(VK_KHR_ANDROID_SURFACE_EXTENSION_NAME);
 #elif defined(_WIN32)
-    info.instance_extension_names.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+        info.instance_extension_names.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_IOS_MVK)
-    info.instance_extension_names.push_back(VK_MVK_IOS_SURFACE_EXTENSION_NAME);
+        info.instance_extension_names.push_back(VK_MVK_IOS_SURFACE_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_MACOS_MVK)
-    info.instance_extension_names.push_back(VK_MVK_MACOS_SURFACE_EXTENSION_NAME);
+        info.instance_extension_names.push_back(VK_MVK_MACOS_SURFACE_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_WAYLAND_KHR)
-    info.instance_extension_names.push_back(VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME);
+        info.instance_extension_names.push_back(VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME);
 #else
-    info.instance_extension_names.push_back(VK_KHR_XCB_SURFACE_EXTENSION_NAME);
+        info.instance_extension_names.push_back(VK_KHR_XCB_SURFACE_EXTENSION_NAME);
 #endif
+    }
 #ifndef __ANDROID__
     info.instance_layer_names.push_back("VK_LAYER_LUNARG_standard_validation");
     if (!demo_check_layers(info.instance_layer_properties,
@@ -211,6 +242,7 @@ void init_instance_extension_names(struct sample_info &info) {
 }
 
 VkResult init_instance(struct sample_info &info, char const *const app_short_name) {
+    TRACE_ZONE("init", __func__);
     VkApplicationInfo app_info = {};
     app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
     app_info.pNext = NULL;
@@ -237,36 +269,78 @@ VkResult init_instance(struct sample_info &info, char const *const app_short_nam
 }
 
 void init_device_extension_names(struct sample_info &info) {
-    info.device_extension_names.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    if (!info.headless) info.device_extension_names.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 }
 
 VkResult init_device(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
     VkResult res;
-    VkDeviceQueueCreateInfo queue_info = {};
+    VkDeviceQueueCreateInfo queue_info[2] = {};
 
     float queue_priorities[1] = {0.0};
-    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    queue_info.pNext = NULL;
-    queue_info.queueCount = 1;
-    queue_info.pQueuePriorities = queue_priorities;
-    queue_info.queueFamilyIndex = info.graphics_queue_family_index;
+    queue_info[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info[0].pNext = NULL;
+    queue_info[0].queueCount = 1;
+    queue_info[0].pQueuePriorities = queue_priorities;
+    queue_info[0].queueFamilyIndex = info.graphics_queue_family_index;
+
+    /*
+     * A family that can only transfer is usually a DMA engine, which copies
+     * to device local memory without taking time from the graphics queue
+     */
+    info.transfer_queue_family_index = UINT32_MAX;
+    for (uint32_t i = 0; i < info.queue_props.size(); i++) {
+        VkQueueFlags flags = info.queue_props[i].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+            info.transfer_queue_family_index = i;
+            break;
+        }
+    }
+    queue_info[1] = queue_info[0];
+    queue_info[1].queueFamilyIndex = info.transfer_queue_family_index;
 
     VkDeviceCreateInfo device_info = {};
     device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     device_info.pNext = NULL;
-    device_info.queueCreateInfoCount = 1;
-    device_info.pQueueCreateInfos = &queue_info;
+    device_info.queueCreateInfoCount = info.transfer_queue_family_index == UINT32_MAX ? 1 : 2;
+    device_info.pQueueCreateInfos = queue_info;
     device_info.enabledExtensionCount = info.device_extension_names.size();
     device_info.ppEnabledExtensionNames = device_info.enabledExtensionCount ? info.device_extension_names.data() : NULL;
     device_info.pEnabledFeatures = NULL;
 
+    VkPhysicalDeviceFeatures features = {};
+    VkPhysicalDeviceFeatures supported;
+    vkGetPhysicalDeviceFeatures(info.gpus[0], &supported);
+
+    // Without it every indirect draw is a call of its own
+    info.multi_draw_indirect = supported.multiDrawIndirect == VK_TRUE;
+    if (info.multi_draw_indirect) {
+        features.multiDrawIndirect = VK_TRUE;
+        device_info.pEnabledFeatures = &features;
+    }
+
+    if (info.benchmark_pipeline_stats) {
+        // Secondary command buffers run inside the queries too
+        if (supported.pipelineStatisticsQuery && supported.inheritedQueries) {
+            features.pipelineStatisticsQuery = VK_TRUE;
+            features.inheritedQueries = VK_TRUE;
+            device_info.pEnabledFeatures = &features;
+        } else {
+            std::cout << "Pipeline statistics queries are not supported, --pipeline-stats is ignored\n";
+            info.benchmark_pipeline_stats = false;
+        }
+    }
+
     res = vkCreateDevice(info.gpus[0], &device_info, NULL, &info.device);
     assert(res == VK_SUCCESS);
 
+    init_device_allocator(info);
+
     return res;
 }
 
 VkResult init_enumerate_device(struct sample_info &info, uint32_t gpu_count) {
+    TRACE_ZONE("init", __func__);
     uint32_t const U_ASSERT_ONLY req_count = gpu_count;
     VkResult res = vkEnumeratePhysicalDevices(info.inst, &gpu_count, NULL);
     assert(gpu_count);
@@ -294,6 +368,7 @@ VkResult init_enumerate_device(struct sample_info &info, uint32_t gpu_count) {
 }
 
 void init_queue_family_index(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
     /* This routine simply finds a graphics queue for a later vkCreateDevice,
      * without consideration for which queue family can present an image.
      * Do not use this if your intent is to present later in your sample,
@@ -321,6 +396,7 @@ void init_queue_family_index(struct sample_info &info) {
 }
 
 VkResult init_debug_report_callback(struct sample_info &info, PFN_vkDebugReportCallbackEXT dbgFunc) {
+    TRACE_ZONE("init", __func__);
     VkResult res;
     VkDebugReportCallbackEXT debug_report_callback;
 
@@ -405,6 +481,8 @@ static const wl_registry_listener registry_listener = {registry_handle_global, r
 #endif
 
 void init_connection(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
+    if (info.headless || info.headless_surface) return;
 #if defined(VK_USE_PLATFORM_XCB_KHR)
     const xcb_setup_t *setup;
     xcb_screen_iterator_t iter;
@@ -458,7 +536,9 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
 }
 
 void init_window(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
     WNDCLASSEX win_class;
+    if (info.headless || info.headless_surface) return;
     assert(info.width > 0);
     assert(info.height > 0);
 
@@ -510,7 +590,9 @@ void init_window(struct sample_info &info) {
 }
 
 void destroy_window(struct sample_info &info) {
+    if (info.headless) return;
     vkDestroySurfaceKHR(info.inst, info.surface, NULL);
+    if (info.headless_surface) return;
     DestroyWindow(info.window);
 }
 
@@ -531,6 +613,8 @@ void destroy_window(struct sample_info &info) {}
 #elif defined(VK_USE_PLATFORM_WAYLAND_KHR)
 
 void init_window(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
+    if (info.headless || info.headless_surface) return;
     assert(info.width > 0);
     assert(info.height > 0);
 
@@ -553,6 +637,11 @@ void init_window(struct sample_info &info) {
 }
 
 void destroy_window(struct sample_info &info) {
+    if (info.headless) return;
+    if (info.headless_surface) {
+        vkDestroySurfaceKHR(info.inst, info.surface, NULL);
+        return;
+    }
     wl_shell_surface_destroy(info.shell_surface);
     wl_surface_destroy(info.window);
     wl_shell_destroy(info.shell);
@@ -564,6 +653,8 @@ void destroy_window(struct sample_info &info) {
 #else
 
 void init_window(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
+    if (info.headless || info.headless_surface) return;
     assert(info.width > 0);
     assert(info.height > 0);
 
@@ -604,7 +695,9 @@ void init_window(struct sample_info &info) {
 }
 
 void destroy_window(struct sample_info &info) {
+    if (info.headless) return;
     vkDestroySurfaceKHR(info.inst, info.surface, NULL);
+    if (info.headless_surface) return;
     xcb_destroy_window(info.connection, info.window);
     xcb_disconnect(info.connection);
 }
@@ -621,6 +714,7 @@ void init_window_size(struct sample_info &info, int32_t default_width, int32_t d
 }
 
 void init_depth_buffer(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
     VkResult U_ASSERT_ONLY res;
     bool U_ASSERT_ONLY pass;
     VkImageCreateInfo image_info = {};
@@ -665,12 +759,6 @@ void init_depth_buffer(struct sample_info &info) {
     image_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
     image_info.flags = 0;
 
-    VkMemoryAllocateInfo mem_alloc = {};
-    mem_alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    mem_alloc.pNext = NULL;
-    mem_alloc.allocationSize = 0;
-    mem_alloc.memoryTypeIndex = 0;
-
     VkImageViewCreateInfo view_info = {};
     view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     view_info.pNext = NULL;
@@ -693,28 +781,14 @@ void init_depth_buffer(struct sample_info &info) {
         view_info.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
     }
 
-    VkMemoryRequirements mem_reqs;
-
     /* Create image */
     res = vkCreateImage(info.device, &image_info, NULL, &info.depth.image);
     assert(res == VK_SUCCESS);
 
-    vkGetImageMemoryRequirements(info.device, info.depth.image, &mem_reqs);
-
-    mem_alloc.allocationSize = mem_reqs.size;
-    /* Use the memory properties to determine the type of memory required */
-    pass =
-        memory_type_from_properties(info, mem_reqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &mem_alloc.memoryTypeIndex);
+    /* Allocate and bind memory, from a block shared with the other device local resources */
+    pass = device_alloc_image(info, info.depth.image, image_info.tiling, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, info.depth.mem);
     assert(pass);
 
-    /* Allocate memory */
-    res = vkAllocateMemory(info.device, &mem_alloc, NULL, &info.depth.mem);
-    assert(res == VK_SUCCESS);
-
-    /* Bind memory */
-    res = vkBindImageMemory(info.device, info.depth.image, info.depth.mem, 0);
-    assert(res == VK_SUCCESS);
-
     /* Create image view */
     view_info.image = info.depth.image;
     res = vkCreateImageView(info.device, &view_info, NULL, &info.depth.view);
@@ -722,11 +796,29 @@ void init_depth_buffer(struct sample_info &info) {
 }
 
 void init_swapchain_extension(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
     /* DEPENDS on init_connection() and init_window() */
 
     VkResult U_ASSERT_ONLY res;
 
+    if (info.headless) {
+        // Nothing is presented, so any graphics queue will do
+        init_queue_family_index(info);
+        info.present_queue_family_index = info.graphics_queue_family_index;
+        info.format = VK_FORMAT_R8G8B8A8_UNORM;
+        return;
+    }
+
 // Construct the surface description:
+    if (info.headless_surface) {
+        GET_INSTANCE_PROC_ADDR(info.inst, CreateHeadlessSurfaceEXT);
+
+        VkHeadlessSurfaceCreateInfoEXT createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+        createInfo.pNext = NULL;
+        createInfo.flags = 0;
+        res = info.fpCreateHeadlessSurfaceEXT(info.inst, &createInfo, NULL, &info.surface);
+    } else {
 #ifdef _WIN32
     VkWin32SurfaceCreateInfoKHR createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
@@ -772,6 +864,7 @@ void init_swapchain_extension(struct sample_info &info) {
     createInfo.window = info.window;
     res = vkCreateXcbSurfaceKHR(info.inst, &createInfo, NULL, &info.surface);
 #endif  // __ANDROID__  && _WIN32
+    }
     assert(res == VK_SUCCESS);
 
     // Iterate over each queue to learn whether it supports presenting:
@@ -834,6 +927,7 @@ void init_swapchain_extension(struct sample_info &info) {
 }
 
 void init_presentable_image(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
     /* DEPENDS on init_swap_chain() */
 
     VkResult U_ASSERT_ONLY res;
@@ -870,7 +964,10 @@ void execute_queue_cmdbuf(struct sample_info &info, const VkCommandBuffer *cmd_b
     submit_info[0].pSignalSemaphores = NULL;
 
     /* Queue the command buffer for execution */
-    res = vkQueueSubmit(info.graphics_queue, 1, submit_info, fence);
+    {
+        TRACE_ZONE("queue", "vkQueueSubmit");
+        res = vkQueueSubmit(info.graphics_queue, 1, submit_info, fence);
+    }
     assert(!res);
 }
 void execute_pre_present_barrier(struct sample_info &info) {
@@ -910,18 +1007,91 @@ void execute_present_image(struct sample_info &info) {
     present.waitSemaphoreCount = 0;
     present.pResults = NULL;
 
-    res = vkQueuePresentKHR(info.present_queue, &present);
+    {
+        TRACE_ZONE("queue", "vkQueuePresentKHR");
+        res = vkQueuePresentKHR(info.present_queue, &present);
+    }
     // TODO: Deal with the VK_SUBOPTIMAL_WSI and VK_ERROR_OUT_OF_DATE_WSI
     // return codes
     assert(!res);
 }
 
+/*
+ * Stands in for the swapchain images when running headless: device local
+ * color images the samples render to as if they had been acquired
+ */
+static void init_headless_images(struct sample_info &info, VkImageUsageFlags usageFlags) {
+    TRACE_ZONE("init", __func__);
+    VkResult U_ASSERT_ONLY res;
+    bool U_ASSERT_ONLY pass;
+
+    VkImageCreateInfo image_info = {};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.pNext = NULL;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = info.format;
+    image_info.extent.width = info.width;
+    image_info.extent.height = info.height;
+    image_info.extent.depth = 1;
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = NUM_SAMPLES;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    image_info.usage = usageFlags;
+    image_info.queueFamilyIndexCount = 0;
+    image_info.pQueueFamilyIndices = NULL;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.flags = 0;
+
+    info.swap_chain = VK_NULL_HANDLE;
+    info.swapchainImageCount = HEADLESS_IMAGE_COUNT;
+    for (uint32_t i = 0; i < info.swapchainImageCount; i++) {
+        swap_chain_buffer sc_buffer;
+
+        res = vkCreateImage(info.device, &image_info, NULL, &sc_buffer.image);
+        assert(res == VK_SUCCESS);
+
+        pass = device_alloc_image(info, sc_buffer.image, image_info.tiling, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  sc_buffer.mem);
+        assert(pass);
+
+        VkImageViewCreateInfo color_image_view = {};
+        color_image_view.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        color_image_view.pNext = NULL;
+        color_image_view.image = sc_buffer.image;
+        color_image_view.format = info.format;
+        color_image_view.components.r = VK_COMPONENT_SWIZZLE_R;
+        color_image_view.components.g = VK_COMPONENT_SWIZZLE_G;
+        color_image_view.components.b = VK_COMPONENT_SWIZZLE_B;
+        color_image_view.components.a = VK_COMPONENT_SWIZZLE_A;
+        color_image_view.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        color_image_view.subresourceRange.baseMipLevel = 0;
+        color_image_view.subresourceRange.levelCount = 1;
+        color_image_view.subresourceRange.baseArrayLayer = 0;
+        color_image_view.subresourceRange.layerCount = 1;
+        color_image_view.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        color_image_view.flags = 0;
+
+        res = vkCreateImageView(info.device, &color_image_view, NULL, &sc_buffer.view);
+        assert(res == VK_SUCCESS);
+        info.buffers.push_back(sc_buffer);
+    }
+    info.current_buffer = 0;
+}
+
 void init_swap_chain(struct sample_info &info, VkImageUsageFlags usageFlags) {
+    TRACE_ZONE("init", __func__);
     /* DEPENDS on info.cmd and info.queue initialized */
 
     VkResult U_ASSERT_ONLY res;
     VkSurfaceCapabilitiesKHR surfCapabilities;
 
+    if (info.headless) {
+        init_headless_images(info, usageFlags);
+        return;
+    }
+
     res = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(info.gpus[0], info.surface, &surfCapabilities);
     assert(res == VK_SUCCESS);
 
@@ -1070,8 +1240,7 @@ void init_swap_chain(struct sample_info &info, VkImageUsageFlags usageFlags) {
 }
 
 void init_uniform_buffer(struct sample_info &info) {
-    VkResult U_ASSERT_ONLY res;
-    bool U_ASSERT_ONLY pass;
+    TRACE_ZONE("init", __func__);
     float fov = glm::radians(45.0f);
     if (info.width > info.height) {
         fov *= static_cast<float>(info.height) / static_cast<float>(info.width);
@@ -1088,71 +1257,113 @@ void init_uniform_buffer(struct sample_info &info) {
     info.MVP = info.Clip * info.Projection * info.View * info.Model;
 
     /* VULKAN_KEY_START */
+    /*
+     * One slot per frame in flight, the same count execute_benchmark() sets
+     * up, so update_uniform_buffer() never writes a slot the GPU may still be
+     * reading.  Rewritten every frame, so it stays host visible even under
+     * --device-local-buffers.
+     */
+    const uint32_t slot_count = info.benchmark_frames_in_flight > 0 ? info.benchmark_frames_in_flight : 1;
+    init_uniform_ring(info, info.uniform_data, sizeof(info.MVP), slot_count);
+    for (uint32_t i = 0; i < slot_count; i++) write_uniform_ring(info, info.uniform_data, i, &info.MVP);
+}
+
+/*
+ * Writes the slot of info.current_frame, whose fence the frame has already
+ * waited on, so frames still on the GPU keep reading their own slots
+ */
+uint32_t update_uniform_buffer(struct sample_info &info) {
+    static auto startTime = std::chrono::high_resolution_clock::now();
+
+    auto currentTime = std::chrono::high_resolution_clock::now();
+    float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+    //info.Model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    info.Model = glm::scale(info.Model, glm::vec3(time * .25f, time * .25f, time * .25f));
+    info.MVP = info.Clip * info.Projection * info.View * info.Model;
+    assert(info.current_frame < info.uniform_data.slot_count);
+    return write_uniform_ring(info, info.uniform_data, info.current_frame, &info.MVP);
+}
+
+uint32_t get_uniform_buffer_offset(struct sample_info &info) {
+    assert(info.current_frame < info.uniform_data.slot_count);
+    return (uint32_t)(info.current_frame * info.uniform_data.stride);
+}
+
+void init_uniform_ring(struct sample_info &info, uniform_ring &ring, VkDeviceSize range, uint32_t slot_count,
+                       bool dedicated) {
+    TRACE_ZONE("init", __func__);
+    VkResult U_ASSERT_ONLY res;
+
+    /*
+     * Prefer coherent memory.  Otherwise every slot has to start and end on a
+     * nonCoherentAtomSize boundary so flushing one slot never touches another.
+     */
+    VkDeviceSize alignment = info.gpu_props.limits.minUniformBufferOffsetAlignment;
+    VkDeviceSize atom = info.gpu_props.limits.nonCoherentAtomSize;
+    if (alignment == 0) alignment = 1;
+
     VkBufferCreateInfo buf_info = {};
     buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     buf_info.pNext = NULL;
     buf_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-    buf_info.size = sizeof(info.MVP);
     buf_info.queueFamilyIndexCount = 0;
     buf_info.pQueueFamilyIndices = NULL;
     buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     buf_info.flags = 0;
-    res = vkCreateBuffer(info.device, &buf_info, NULL, &info.uniform_data.buf);
-    assert(res == VK_SUCCESS);
-
-    VkMemoryRequirements mem_reqs;
-    vkGetBufferMemoryRequirements(info.device, info.uniform_data.buf, &mem_reqs);
-
-    VkMemoryAllocateInfo alloc_info = {};
-    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    alloc_info.pNext = NULL;
-    alloc_info.memoryTypeIndex = 0;
-
-    alloc_info.allocationSize = mem_reqs.size;
-    pass = memory_type_from_properties(info, mem_reqs.memoryTypeBits,
-                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                       &alloc_info.memoryTypeIndex);
-    assert(pass && "No mappable, coherent memory");
-
-    res = vkAllocateMemory(info.device, &alloc_info, NULL, &(info.uniform_data.mem));
-    assert(res == VK_SUCCESS);
 
-    uint8_t *pData;
-    res = vkMapMemory(info.device, info.uniform_data.mem, 0, mem_reqs.size, 0, (void **)&pData);
+    // The stride only depends on coherency, size the buffer for the worst case first
+    VkDeviceSize worst_alignment = std::max(alignment, atom);
+    buf_info.size = ((range + worst_alignment - 1) / worst_alignment) * worst_alignment * slot_count;
+    res = vkCreateBuffer(info.device, &buf_info, NULL, &ring.buf);
     assert(res == VK_SUCCESS);
 
-    memcpy(pData, &info.MVP, sizeof(info.MVP));
-
-    vkUnmapMemory(info.device, info.uniform_data.mem);
-
-    res = vkBindBufferMemory(info.device, info.uniform_data.buf, info.uniform_data.mem, 0);
-    assert(res == VK_SUCCESS);
-
-    info.uniform_data.buffer_info.buffer = info.uniform_data.buf;
-    info.uniform_data.buffer_info.offset = 0;
-    info.uniform_data.buffer_info.range = sizeof(info.MVP);
-}
-
-void update_uniform_buffer(struct sample_info &info){
-  static auto startTime = std::chrono::high_resolution_clock::now();
-
-  auto currentTime = std::chrono::high_resolution_clock::now();
-  float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-  //info.Model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-  info.Model = glm::scale(info.Model, glm::vec3(time * .25f, time * .25f, time * .25f));
-  info.MVP = info.Clip * info.Projection * info.View * info.Model;
-  uint8_t *pData;
-  vkMapMemory(info.device, info.uniform_data.mem, 0, sizeof(info.MVP), 0, (void **) &pData);
-  memcpy(pData, &info.MVP, sizeof(info.MVP));
-  vkUnmapMemory(info.device, info.uniform_data.mem);
+    /*
+     * Sub-allocated chunks start on a multiple of their power of two size, at
+     * least 256 bytes, so slot flushes stay on nonCoherentAtomSize boundaries
+     */
+    ring.coherent = device_alloc_buffer(info, ring.buf,
+                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, ring.mem,
+                                        dedicated);
+    if (!ring.coherent) {
+        bool U_ASSERT_ONLY pass = device_alloc_buffer(info, ring.buf, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, ring.mem, dedicated);
+        assert(pass && "No mappable memory");
+        alignment = worst_alignment;
+    }
+    ring.range = range;
+    ring.stride = ((range + alignment - 1) / alignment) * alignment;
+    ring.slot_count = slot_count;
+    ring.mapped = ring.mem.mapped;
+
+    ring.buffer_info.buffer = ring.buf;
+    ring.buffer_info.offset = 0;
+    ring.buffer_info.range = range;
+}
+
+uint32_t write_uniform_ring(struct sample_info &info, uniform_ring &ring, uint32_t slot, const void *data) {
+    assert(ring.mapped && "A dedicated ring is not mapped");
+    VkDeviceSize offset = slot * ring.stride;
+    memcpy(ring.mapped + offset, data, (size_t)ring.range);
+
+    if (!ring.coherent) {
+        VkMappedMemoryRange flush_range = {};
+        flush_range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        flush_range.pNext = NULL;
+        flush_range.memory = ring.mem.memory;
+        flush_range.offset = ring.mem.offset + offset;
+        flush_range.size = ring.stride;
+        VkResult U_ASSERT_ONLY res = vkFlushMappedMemoryRanges(info.device, 1, &flush_range);
+        assert(res == VK_SUCCESS);
+    }
+    return (uint32_t)offset;
 }
 
-
 void init_descriptor_and_pipeline_layouts(struct sample_info &info, bool use_texture,
-                                          VkDescriptorSetLayoutCreateFlags descSetLayoutCreateFlags) {
+                                          VkDescriptorSetLayoutCreateFlags descSetLayoutCreateFlags,
+                                          uint32_t pushConstantSize, VkDescriptorType uniformType) {
+    TRACE_ZONE("init", __func__);
     VkDescriptorSetLayoutBinding layout_bindings[2];
     layout_bindings[0].binding = 0;
-    layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    layout_bindings[0].descriptorType = uniformType;
     layout_bindings[0].descriptorCount = 1;
     layout_bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
     layout_bindings[0].pImmutableSamplers = NULL;
@@ -1180,12 +1391,18 @@ void init_descriptor_and_pipeline_layouts(struct sample_info &info, bool use_tex
     res = vkCreateDescriptorSetLayout(info.device, &descriptor_layout, NULL, info.desc_layout.data());
     assert(res == VK_SUCCESS);
 
+    /* Push constants, when asked for, are read by the vertex shader from offset 0 */
+    VkPushConstantRange push_constant_range;
+    push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = pushConstantSize;
+
     /* Now use the descriptor layout to create a pipeline layout */
     VkPipelineLayoutCreateInfo pPipelineLayoutCreateInfo = {};
     pPipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pPipelineLayoutCreateInfo.pNext = NULL;
-    pPipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-    pPipelineLayoutCreateInfo.pPushConstantRanges = NULL;
+    pPipelineLayoutCreateInfo.pushConstantRangeCount = pushConstantSize ? 1 : 0;
+    pPipelineLayoutCreateInfo.pPushConstantRanges = pushConstantSize ? &push_constant_range : NULL;
     pPipelineLayoutCreateInfo.setLayoutCount = NUM_DESCRIPTOR_SETS;
     pPipelineLayoutCreateInfo.pSetLayouts = info.desc_layout.data();
 
@@ -1194,15 +1411,24 @@ void init_descriptor_and_pipeline_layouts(struct sample_info &info, bool use_tex
 }
 
 void init_renderpass(struct sample_info &info, bool include_depth, bool clear, VkImageLayout finalLayout) {
+    init_renderpass_ops(info, include_depth, clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD,
+                        VK_ATTACHMENT_STORE_OP_STORE, finalLayout);
+}
+
+void init_renderpass_ops(struct sample_info &info, bool include_depth, VkAttachmentLoadOp loadOp,
+                         VkAttachmentStoreOp storeOp, VkImageLayout finalLayout) {
+    TRACE_ZONE("init", __func__);
     /* DEPENDS on init_swap_chain() and init_depth_buffer() */
 
     VkResult U_ASSERT_ONLY res;
+    /* Without VK_KHR_swapchain there is no present layout, leave headless images ready to render to */
+    if (info.headless && finalLayout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR) finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
     /* Need attachments for render target and depth buffer */
     VkAttachmentDescription attachments[2];
     attachments[0].format = info.format;
     attachments[0].samples = NUM_SAMPLES;
-    attachments[0].loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
-    attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[0].loadOp = loadOp;
+    attachments[0].storeOp = storeOp;
     attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -1212,8 +1438,8 @@ void init_renderpass(struct sample_info &info, bool include_depth, bool clear, V
     if (include_depth) {
         attachments[1].format = info.depth.format;
         attachments[1].samples = NUM_SAMPLES;
-        attachments[1].loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
-        attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachments[1].loadOp = loadOp;
+        attachments[1].storeOp = storeOp;
         attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
         attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
         attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -1256,6 +1482,7 @@ void init_renderpass(struct sample_info &info, bool include_depth, bool clear, V
 }
 
 void init_framebuffers(struct sample_info &info, bool include_depth) {
+    TRACE_ZONE("init", __func__);
     /* DEPENDS on init_depth_buffer(), init_renderpass() and
      * init_swapchain_extension() */
 
@@ -1284,6 +1511,7 @@ void init_framebuffers(struct sample_info &info, bool include_depth) {
     }
 }
 void init_command_pool(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
     /* DEPENDS on init_swapchain_extension() */
     VkResult U_ASSERT_ONLY res;
 
@@ -1298,6 +1526,7 @@ void init_command_pool(struct sample_info &info) {
 }
 
 void init_command_buffer(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
     /* DEPENDS on init_swapchain_extension() and init_command_pool() */
     VkResult U_ASSERT_ONLY res;
 
@@ -1314,6 +1543,7 @@ void init_command_buffer(struct sample_info &info) {
 
 
 void init_command_buffer_array(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
     /* DEPENDS on init_swapchain_extension() and init_command_pool() */
     VkResult U_ASSERT_ONLY res;
 
@@ -1322,13 +1552,15 @@ void init_command_buffer_array(struct sample_info &info) {
     cmd.pNext = NULL;
     cmd.commandPool = info.cmd_pool;
     cmd.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    cmd.commandBufferCount = NUM_BUFFERS;
+    cmd.commandBufferCount = info.benchmark_draws;
 
-    res = vkAllocateCommandBuffers(info.device, &cmd, info.cmds);
+    info.cmds.resize(info.benchmark_draws);
+    res = vkAllocateCommandBuffers(info.device, &cmd, info.cmds.data());
     assert(res == VK_SUCCESS);
 }
 
 void init_command_buffer2(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
     /* DEPENDS on init_swapchain_extension() and init_command_pool() */
     VkResult U_ASSERT_ONLY res;
 
@@ -1345,6 +1577,7 @@ void init_command_buffer2(struct sample_info &info) {
 
 
 void init_command_buffer2_array(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
     /* DEPENDS on init_swapchain_extension() and init_command_pool() */
     VkResult U_ASSERT_ONLY res;
 
@@ -1353,9 +1586,10 @@ void init_command_buffer2_array(struct sample_info &info) {
     cmd.pNext = NULL;
     cmd.commandPool = info.cmd_pool;
     cmd.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
-    cmd.commandBufferCount = NUM_BUFFERS;
+    cmd.commandBufferCount = info.benchmark_draws;
 
-    res = vkAllocateCommandBuffers(info.device, &cmd, info.cmd2s);
+    info.cmd2s.resize(info.benchmark_draws);
+    res = vkAllocateCommandBuffers(info.device, &cmd, info.cmd2s.data());
     assert(res == VK_SUCCESS);
 }
 
@@ -1405,7 +1639,10 @@ void execute_queue_command_buffer(struct sample_info &info) {
     submit_info[0].signalSemaphoreCount = 0;
     submit_info[0].pSignalSemaphores = NULL;
 
-    res = vkQueueSubmit(info.graphics_queue, 1, submit_info, drawFence);
+    {
+        TRACE_ZONE("queue", "vkQueueSubmit");
+        res = vkQueueSubmit(info.graphics_queue, 1, submit_info, drawFence);
+    }
     assert(res == VK_SUCCESS);
 
     do {
@@ -1417,6 +1654,7 @@ void execute_queue_command_buffer(struct sample_info &info) {
 }
 
 void init_device_queue(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
     /* DEPENDS on init_swapchain_extension() */
 
     vkGetDeviceQueue(info.device, info.graphics_queue_family_index, 0, &info.graphics_queue);
@@ -1425,54 +1663,263 @@ void init_device_queue(struct sample_info &info) {
     } else {
         vkGetDeviceQueue(info.device, info.present_queue_family_index, 0, &info.present_queue);
     }
+    info.transfer_queue = VK_NULL_HANDLE;
+    if (info.transfer_queue_family_index != UINT32_MAX) {
+        vkGetDeviceQueue(info.device, info.transfer_queue_family_index, 0, &info.transfer_queue);
+    }
 }
 
-void init_vertex_buffer(struct sample_info &info, const void *vertexData, uint32_t dataSize, uint32_t dataStride,
-                        bool use_texture) {
+/*
+ * Stages and accesses of the graphics queue reading a buffer with the given
+ * usage, the second half of the barrier making an upload to it visible
+ */
+static void buffer_usage_reads(VkBufferUsageFlags usage, VkPipelineStageFlags &stages, VkAccessFlags &access) {
+    stages = 0;
+    access = 0;
+    if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) {
+        stages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        access |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    }
+    if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
+        stages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        access |= VK_ACCESS_INDEX_READ_BIT;
+    }
+    if (usage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT) {
+        stages |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+        access |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    }
+    if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+        stages |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        access |= VK_ACCESS_UNIFORM_READ_BIT;
+    }
+    if (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) {
+        stages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+        access |= VK_ACCESS_TRANSFER_READ_BIT;
+    }
+    if (!stages) stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+}
+
+void execute_copy_buffer(struct sample_info &info, VkBuffer src, VkBuffer dst, VkDeviceSize size,
+                         VkBufferUsageFlags dst_usage, bool use_transfer_queue) {
+    TRACE_ZONE("init", __func__);
+    VkResult U_ASSERT_ONLY res;
+    const bool transfer = use_transfer_queue && info.transfer_queue != VK_NULL_HANDLE;
+
+    VkPipelineStageFlags dst_stages;
+    VkAccessFlags dst_access;
+    buffer_usage_reads(dst_usage, dst_stages, dst_access);
+
+    VkCommandPool transfer_pool = VK_NULL_HANDLE;
+    if (transfer) {
+        VkCommandPoolCreateInfo cmd_pool_info = {};
+        cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        cmd_pool_info.pNext = NULL;
+        cmd_pool_info.queueFamilyIndex = info.transfer_queue_family_index;
+        cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        res = vkCreateCommandPool(info.device, &cmd_pool_info, NULL, &transfer_pool);
+        assert(res == VK_SUCCESS);
+    }
+
+    // [0] copies, on the transfer queue when there is one, [1] acquires dst on the graphics queue
+    VkCommandBuffer cmd_bufs[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+    VkCommandBufferAllocateInfo cmd_info = {};
+    cmd_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cmd_info.pNext = NULL;
+    cmd_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmd_info.commandBufferCount = 1;
+    cmd_info.commandPool = transfer ? transfer_pool : info.cmd_pool;
+    res = vkAllocateCommandBuffers(info.device, &cmd_info, &cmd_bufs[0]);
+    assert(res == VK_SUCCESS);
+    if (transfer) {
+        cmd_info.commandPool = info.cmd_pool;
+        res = vkAllocateCommandBuffers(info.device, &cmd_info, &cmd_bufs[1]);
+        assert(res == VK_SUCCESS);
+    }
+
+    VkCommandBufferBeginInfo cmd_buf_info = {};
+    cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cmd_buf_info.pNext = NULL;
+    cmd_buf_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    cmd_buf_info.pInheritanceInfo = NULL;
+
+    VkBufferCopy region = {0, 0, size};
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.pNext = NULL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = dst_access;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = dst;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    res = vkBeginCommandBuffer(cmd_bufs[0], &cmd_buf_info);
+    assert(res == VK_SUCCESS);
+    vkCmdCopyBuffer(cmd_bufs[0], src, dst, 1, &region);
+    if (transfer) {
+        /*
+         * The release half of the queue family ownership transfer.  Its
+         * destination scope is ignored, the acquire below makes the copy
+         * visible to the graphics queue.
+         */
+        barrier.dstAccessMask = 0;
+        barrier.srcQueueFamilyIndex = info.transfer_queue_family_index;
+        barrier.dstQueueFamilyIndex = info.graphics_queue_family_index;
+        vkCmdPipelineBarrier(cmd_bufs[0], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL,
+                             1, &barrier, 0, NULL);
+    } else {
+        vkCmdPipelineBarrier(cmd_bufs[0], VK_PIPELINE_STAGE_TRANSFER_BIT, dst_stages, 0, 0, NULL, 1, &barrier, 0, NULL);
+    }
+    res = vkEndCommandBuffer(cmd_bufs[0]);
+    assert(res == VK_SUCCESS);
+
+    VkSemaphore copied = VK_NULL_HANDLE;
+    if (transfer) {
+        // The acquire half, with the same buffer range and queue families as the release
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = dst_access;
+        res = vkBeginCommandBuffer(cmd_bufs[1], &cmd_buf_info);
+        assert(res == VK_SUCCESS);
+        vkCmdPipelineBarrier(cmd_bufs[1], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dst_stages, 0, 0, NULL, 1, &barrier, 0, NULL);
+        res = vkEndCommandBuffer(cmd_bufs[1]);
+        assert(res == VK_SUCCESS);
+
+        VkSemaphoreCreateInfo semaphore_info = {};
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphore_info.pNext = NULL;
+        semaphore_info.flags = 0;
+        res = vkCreateSemaphore(info.device, &semaphore_info, NULL, &copied);
+        assert(res == VK_SUCCESS);
+    }
+
+    VkFenceCreateInfo fence_info = {};
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fence_info.pNext = NULL;
+    fence_info.flags = 0;
+    VkFence done;
+    res = vkCreateFence(info.device, &fence_info, NULL, &done);
+    assert(res == VK_SUCCESS);
+
+    VkSubmitInfo submit_info[2] = {};
+    submit_info[0].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info[0].pNext = NULL;
+    submit_info[0].commandBufferCount = 1;
+    submit_info[0].pCommandBuffers = &cmd_bufs[0];
+    submit_info[0].signalSemaphoreCount = transfer ? 1 : 0;
+    submit_info[0].pSignalSemaphores = &copied;
+    {
+        TRACE_ZONE("queue", "vkQueueSubmit");
+        res = vkQueueSubmit(transfer ? info.transfer_queue : info.graphics_queue, 1, &submit_info[0],
+                            transfer ? VK_NULL_HANDLE : done);
+    }
+    assert(res == VK_SUCCESS);
+    if (transfer) {
+        // The graphics queue only waits where the barrier's reads start
+        submit_info[1].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info[1].pNext = NULL;
+        submit_info[1].waitSemaphoreCount = 1;
+        submit_info[1].pWaitSemaphores = &copied;
+        submit_info[1].pWaitDstStageMask = &dst_stages;
+        submit_info[1].commandBufferCount = 1;
+        submit_info[1].pCommandBuffers = &cmd_bufs[1];
+        {
+            TRACE_ZONE("queue", "vkQueueSubmit");
+            res = vkQueueSubmit(info.graphics_queue, 1, &submit_info[1], done);
+        }
+        assert(res == VK_SUCCESS);
+    }
+
+    // The acquire waited on the copy, so its fence covers both queues
+    do {
+        res = vkWaitForFences(info.device, 1, &done, VK_TRUE, FENCE_TIMEOUT);
+    } while (res == VK_TIMEOUT);
+    assert(res == VK_SUCCESS);
+
+    vkDestroyFence(info.device, done, NULL);
+    if (transfer) {
+        vkDestroySemaphore(info.device, copied, NULL);
+        vkFreeCommandBuffers(info.device, info.cmd_pool, 1, &cmd_bufs[1]);
+        vkDestroyCommandPool(info.device, transfer_pool, NULL);
+    } else {
+        vkFreeCommandBuffers(info.device, info.cmd_pool, 1, &cmd_bufs[0]);
+    }
+}
+
+void init_device_local_buffer(struct sample_info &info, VkBufferUsageFlags usage, const void *data, VkDeviceSize size,
+                              VkBuffer &buf, device_allocation &mem) {
+    TRACE_ZONE("init", __func__);
+    /* DEPENDS on init_command_pool() and init_device_queue() */
     VkResult U_ASSERT_ONLY res;
     bool U_ASSERT_ONLY pass;
 
     VkBufferCreateInfo buf_info = {};
     buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     buf_info.pNext = NULL;
-    buf_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-    buf_info.size = dataSize;
+    buf_info.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    buf_info.size = size;
     buf_info.queueFamilyIndexCount = 0;
     buf_info.pQueueFamilyIndices = NULL;
     buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     buf_info.flags = 0;
-    res = vkCreateBuffer(info.device, &buf_info, NULL, &info.vertex_buffer.buf);
+    res = vkCreateBuffer(info.device, &buf_info, NULL, &buf);
     assert(res == VK_SUCCESS);
 
-    VkMemoryRequirements mem_reqs;
-    vkGetBufferMemoryRequirements(info.device, info.vertex_buffer.buf, &mem_reqs);
+    pass = device_alloc_buffer(info, buf, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mem);
+    assert(pass && "No device local memory");
 
-    VkMemoryAllocateInfo alloc_info = {};
-    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    alloc_info.pNext = NULL;
-    alloc_info.memoryTypeIndex = 0;
+    // Only ever read by the copy, so the staging buffer never changes queue family
+    VkBuffer staging_buf;
+    device_allocation staging_mem;
+    buf_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    res = vkCreateBuffer(info.device, &buf_info, NULL, &staging_buf);
+    assert(res == VK_SUCCESS);
 
-    alloc_info.allocationSize = mem_reqs.size;
-    pass = memory_type_from_properties(info, mem_reqs.memoryTypeBits,
-                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                       &alloc_info.memoryTypeIndex);
+    pass = device_alloc_buffer(info, staging_buf, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                               staging_mem);
     assert(pass && "No mappable, coherent memory");
+    memcpy(staging_mem.mapped, data, size);
 
-    res = vkAllocateMemory(info.device, &alloc_info, NULL, &(info.vertex_buffer.mem));
-    assert(res == VK_SUCCESS);
-    info.vertex_buffer.buffer_info.range = mem_reqs.size;
-    info.vertex_buffer.buffer_info.offset = 0;
+    execute_copy_buffer(info, staging_buf, buf, size, usage);
 
-    uint8_t *pData;
-    res = vkMapMemory(info.device, info.vertex_buffer.mem, 0, mem_reqs.size, 0, (void **)&pData);
-    assert(res == VK_SUCCESS);
+    vkDestroyBuffer(info.device, staging_buf, NULL);
+    device_free(info, staging_mem);
+}
+
+void init_vertex_buffer(struct sample_info &info, const void *vertexData, uint32_t dataSize, uint32_t dataStride,
+                        bool use_texture) {
+    TRACE_ZONE("init", __func__);
+    VkResult U_ASSERT_ONLY res;
+    bool U_ASSERT_ONLY pass;
 
-    memcpy(pData, vertexData, dataSize);
+    // Also a copy source, for the vertex_placement benchmark
+    const VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    if (info.device_local_buffers) {
+        init_device_local_buffer(info, usage, vertexData, dataSize, info.vertex_buffer.buf, info.vertex_buffer.mem);
+        info.vertex_buffer.buffer_info.range = dataSize;
+        info.vertex_buffer.buffer_info.offset = 0;
+    } else {
+        VkBufferCreateInfo buf_info = {};
+        buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buf_info.pNext = NULL;
+        buf_info.usage = usage;
+        buf_info.size = dataSize;
+        buf_info.queueFamilyIndexCount = 0;
+        buf_info.pQueueFamilyIndices = NULL;
+        buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        buf_info.flags = 0;
+        res = vkCreateBuffer(info.device, &buf_info, NULL, &info.vertex_buffer.buf);
+        assert(res == VK_SUCCESS);
 
-    vkUnmapMemory(info.device, info.vertex_buffer.mem);
+        pass = device_alloc_buffer(info, info.vertex_buffer.buf,
+                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                   info.vertex_buffer.mem);
+        assert(pass && "No mappable, coherent memory");
+        info.vertex_buffer.buffer_info.range = info.vertex_buffer.mem.size;
+        info.vertex_buffer.buffer_info.offset = 0;
 
-    res = vkBindBufferMemory(info.device, info.vertex_buffer.buf, info.vertex_buffer.mem, 0);
-    assert(res == VK_SUCCESS);
+        memcpy(info.vertex_buffer.mem.mapped, vertexData, dataSize);
+    }
 
     info.vi_binding.binding = 0;
     info.vi_binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
@@ -1486,15 +1933,60 @@ void init_vertex_buffer(struct sample_info &info, const void *vertexData, uint32
     info.vi_attribs[1].location = 1;
     info.vi_attribs[1].format = use_texture ? VK_FORMAT_R32G32_SFLOAT : VK_FORMAT_R32G32B32A32_SFLOAT;
     info.vi_attribs[1].offset = 16;
+
+    info.vertex_count = dataSize / dataStride;
+}
+
+void init_instance_buffer(struct sample_info &info, const glm::mat4 *transforms, uint32_t count) {
+    TRACE_ZONE("init", __func__);
+    /* DEPENDS on init_vertex_buffer(), the transforms go in binding 1 */
+    VkResult U_ASSERT_ONLY res;
+    bool U_ASSERT_ONLY pass;
+
+    VkBufferCreateInfo buf_info = {};
+    buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buf_info.pNext = NULL;
+    buf_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    buf_info.size = count * sizeof(glm::mat4);
+    buf_info.queueFamilyIndexCount = 0;
+    buf_info.pQueueFamilyIndices = NULL;
+    buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    buf_info.flags = 0;
+    res = vkCreateBuffer(info.device, &buf_info, NULL, &info.instance_buffer.buf);
+    assert(res == VK_SUCCESS);
+
+    pass = device_alloc_buffer(info, info.instance_buffer.buf,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                               info.instance_buffer.mem);
+    assert(pass && "No mappable, coherent memory");
+    info.instance_buffer.buffer_info.buffer = info.instance_buffer.buf;
+    info.instance_buffer.buffer_info.range = buf_info.size;
+    info.instance_buffer.buffer_info.offset = 0;
+
+    memcpy(info.instance_buffer.mem.mapped, transforms, buf_info.size);
+
+    info.instance_count = count;
+    info.vi_instance_binding.binding = 1;
+    info.vi_instance_binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    info.vi_instance_binding.stride = sizeof(glm::mat4);
+
+    /* A mat4 input takes four locations, after the vertex attributes */
+    for (uint32_t i = 0; i < 4; i++) {
+        info.vi_instance_attribs[i].binding = 1;
+        info.vi_instance_attribs[i].location = 2 + i;
+        info.vi_instance_attribs[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        info.vi_instance_attribs[i].offset = i * sizeof(glm::vec4);
+    }
 }
 
 void init_descriptor_pool(struct sample_info &info, bool use_texture) {
+    TRACE_ZONE("init", __func__);
     /* DEPENDS on init_uniform_buffer() and
      * init_descriptor_and_pipeline_layouts() */
 
     VkResult U_ASSERT_ONLY res;
     VkDescriptorPoolSize type_count[2];
-    type_count[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    type_count[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     type_count[0].descriptorCount = 1;
     if (use_texture) {
         type_count[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -1513,6 +2005,7 @@ void init_descriptor_pool(struct sample_info &info, bool use_texture) {
 }
 
 void init_descriptor_set(struct sample_info &info, bool use_texture) {
+    TRACE_ZONE("init", __func__);
     /* DEPENDS on init_descriptor_pool() */
 
     VkResult U_ASSERT_ONLY res;
@@ -1535,7 +2028,7 @@ void init_descriptor_set(struct sample_info &info, bool use_texture) {
     writes[0].pNext = NULL;
     writes[0].dstSet = info.desc_set[0];
     writes[0].descriptorCount = 1;
-    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; // Bound at get_uniform_buffer_offset()
     writes[0].pBufferInfo = &info.uniform_data.buffer_info;
     writes[0].dstArrayElement = 0;
     writes[0].dstBinding = 0;
@@ -1555,6 +2048,7 @@ void init_descriptor_set(struct sample_info &info, bool use_texture) {
 }
 
 void init_shaders(struct sample_info &info, const char *vertShaderText, const char *fragShaderText) {
+    TRACE_ZONE("init", __func__);
     VkResult U_ASSERT_ONLY res;
     bool U_ASSERT_ONLY retVal;
 
@@ -1609,7 +2103,38 @@ void init_shaders(struct sample_info &info, const char *vertShaderText, const ch
     finalize_glslang();
 }
 
+void init_push_constant_shader(struct sample_info &info, const char *vertShaderText) {
+    TRACE_ZONE("init", __func__);
+    /* A vertex shader reading what the sample's reads from its uniform buffer */
+    /* from push constants instead, used by init_pipeline() when asked to     */
+    VkResult U_ASSERT_ONLY res;
+    bool U_ASSERT_ONLY retVal;
+
+    init_glslang();
+    std::vector<unsigned int> vtx_spv;
+    info.push_constant_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    info.push_constant_stage.pNext = NULL;
+    info.push_constant_stage.pSpecializationInfo = NULL;
+    info.push_constant_stage.flags = 0;
+    info.push_constant_stage.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    info.push_constant_stage.pName = "main";
+
+    retVal = GLSLtoSPV(VK_SHADER_STAGE_VERTEX_BIT, vertShaderText, vtx_spv);
+    assert(retVal);
+
+    VkShaderModuleCreateInfo moduleCreateInfo;
+    moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleCreateInfo.pNext = NULL;
+    moduleCreateInfo.flags = 0;
+    moduleCreateInfo.codeSize = vtx_spv.size() * sizeof(unsigned int);
+    moduleCreateInfo.pCode = vtx_spv.data();
+    res = vkCreateShaderModule(info.device, &moduleCreateInfo, NULL, &info.push_constant_stage.module);
+    assert(res == VK_SUCCESS);
+    finalize_glslang();
+}
+
 void init_pipeline_cache(struct sample_info &info) {
+    TRACE_ZONE("init", __func__);
     VkResult U_ASSERT_ONLY res;
 
     VkPipelineCacheCreateInfo pipelineCache;
@@ -1622,7 +2147,8 @@ void init_pipeline_cache(struct sample_info &info) {
     assert(res == VK_SUCCESS);
 }
 
-void init_pipeline(struct sample_info &info, VkBool32 include_depth, VkBool32 include_vi) {
+void init_pipeline(struct sample_info &info, VkBool32 include_depth, VkBool32 include_vi, VkBool32 use_push_constants) {
+    TRACE_ZONE("init", __func__);
     VkResult U_ASSERT_ONLY res;
 
     VkDynamicState dynamicStateEnables[VK_DYNAMIC_STATE_RANGE_SIZE];
@@ -1636,13 +2162,19 @@ void init_pipeline(struct sample_info &info, VkBool32 include_depth, VkBool32 in
     VkPipelineVertexInputStateCreateInfo vi;
     memset(&vi, 0, sizeof(vi));
     vi.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    VkVertexInputBindingDescription vi_bindings[2] = {info.vi_binding, info.vi_instance_binding};
+    VkVertexInputAttributeDescription vi_attribs[6] = {info.vi_attribs[0],          info.vi_attribs[1],
+                                                       info.vi_instance_attribs[0], info.vi_instance_attribs[1],
+                                                       info.vi_instance_attribs[2], info.vi_instance_attribs[3]};
     if (include_vi) {
+        /* The per-instance stream follows the vertices when there is one */
+        const bool instanced = info.instance_buffer.buf != VK_NULL_HANDLE;
         vi.pNext = NULL;
         vi.flags = 0;
-        vi.vertexBindingDescriptionCount = 1;
-        vi.pVertexBindingDescriptions = &info.vi_binding;
-        vi.vertexAttributeDescriptionCount = 2;
-        vi.pVertexAttributeDescriptions = info.vi_attribs;
+        vi.vertexBindingDescriptionCount = instanced ? 2 : 1;
+        vi.pVertexBindingDescriptions = vi_bindings;
+        vi.vertexAttributeDescriptionCount = instanced ? 6 : 2;
+        vi.pVertexAttributeDescriptions = vi_attribs;
     }
     VkPipelineInputAssemblyStateCreateInfo ia;
     ia.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -1767,7 +2299,11 @@ void init_pipeline(struct sample_info &info, VkBool32 include_depth, VkBool32 in
     pipeline.pDynamicState = &dynamicState;
     pipeline.pViewportState = &vp;
     pipeline.pDepthStencilState = &ds;
-    pipeline.pStages = info.shaderStages;
+    /* DEPENDS on init_push_constant_shader() and a layout with a push constant range */
+    /* when use_push_constants is set                                            */
+    VkPipelineShaderStageCreateInfo stages[2] = {use_push_constants ? info.push_constant_stage : info.shaderStages[0],
+                                                 info.shaderStages[1]};
+    pipeline.pStages = stages;
     pipeline.stageCount = 2;
     pipeline.renderPass = info.render_pass;
     pipeline.subpass = 0;
@@ -1777,6 +2313,7 @@ void init_pipeline(struct sample_info &info, VkBool32 include_depth, VkBool32 in
 }
 
 void init_sampler(struct sample_info &info, VkSampler &sampler) {
+    TRACE_ZONE("init", __func__);
     VkResult U_ASSERT_ONLY res;
 
     VkSamplerCreateInfo samplerCreateInfo = {};
@@ -1803,6 +2340,7 @@ void init_sampler(struct sample_info &info, VkSampler &sampler) {
 
 void init_image(struct sample_info &info, texture_object &texObj, const char *textureName, VkImageUsageFlags extraUsages,
                 VkFormatFeatureFlags extraFeatures) {
+    TRACE_ZONE("init", __func__);
     VkResult U_ASSERT_ONLY res;
     bool U_ASSERT_ONLY pass;
     std::string filename = get_base_data_dir();
@@ -1857,41 +2395,19 @@ void init_image(struct sample_info &info, texture_object &texObj, const char *te
     image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     image_create_info.flags = 0;
 
-    VkMemoryAllocateInfo mem_alloc = {};
-    mem_alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    mem_alloc.pNext = NULL;
-    mem_alloc.allocationSize = 0;
-    mem_alloc.memoryTypeIndex = 0;
-
     VkImage mappableImage;
-    VkDeviceMemory mappableMemory;
-
-    VkMemoryRequirements mem_reqs;
+    device_allocation mappableMemory;
 
     /* Create a mappable image.  It will be the texture if linear images are ok
      * to be textures or it will be the staging image if they are not. */
     res = vkCreateImage(info.device, &image_create_info, NULL, &mappableImage);
     assert(res == VK_SUCCESS);
 
-    vkGetImageMemoryRequirements(info.device, mappableImage, &mem_reqs);
-    assert(res == VK_SUCCESS);
-
-    mem_alloc.allocationSize = mem_reqs.size;
-
-    /* Find the memory type that is host mappable */
-    pass = memory_type_from_properties(info, mem_reqs.memoryTypeBits,
-                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                       &mem_alloc.memoryTypeIndex);
+    /* Allocate and bind host mappable memory, it stays mapped */
+    pass = device_alloc_image(info, mappableImage, VK_IMAGE_TILING_LINEAR,
+                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, mappableMemory);
     assert(pass && "No mappable, coherent memory");
 
-    /* allocate memory */
-    res = vkAllocateMemory(info.device, &mem_alloc, NULL, &(mappableMemory));
-    assert(res == VK_SUCCESS);
-
-    /* bind memory */
-    res = vkBindImageMemory(info.device, mappableImage, mappableMemory, 0);
-    assert(res == VK_SUCCESS);
-
     res = vkEndCommandBuffer(info.cmd);
     assert(res == VK_SUCCESS);
     const VkCommandBuffer cmd_bufs[] = {info.cmd};
@@ -1914,7 +2430,10 @@ void init_image(struct sample_info &info, texture_object &texObj, const char *te
     submit_info[0].pSignalSemaphores = NULL;
 
     /* Queue the command buffer for execution */
-    res = vkQueueSubmit(info.graphics_queue, 1, submit_info, cmdFence);
+    {
+        TRACE_ZONE("queue", "vkQueueSubmit");
+        res = vkQueueSubmit(info.graphics_queue, 1, submit_info, cmdFence);
+    }
     assert(res == VK_SUCCESS);
 
     VkImageSubresource subres = {};
@@ -1923,7 +2442,6 @@ void init_image(struct sample_info &info, texture_object &texObj, const char *te
     subres.arrayLayer = 0;
 
     VkSubresourceLayout layout;
-    void *data;
 
     /* Get the subresource layout so we know what the row pitch is */
     vkGetImageSubresourceLayout(info.device, mappableImage, &subres, &layout);
@@ -1936,17 +2454,12 @@ void init_image(struct sample_info &info, texture_object &texObj, const char *te
 
     vkDestroyFence(info.device, cmdFence, NULL);
 
-    res = vkMapMemory(info.device, mappableMemory, 0, mem_reqs.size, 0, &data);
-    assert(res == VK_SUCCESS);
-
     /* Read the ppm file into the mappable image's memory */
-    if (!read_ppm(filename.c_str(), texObj.tex_width, texObj.tex_height, layout.rowPitch, (unsigned char *)data)) {
+    if (!read_ppm(filename.c_str(), texObj.tex_width, texObj.tex_height, layout.rowPitch, mappableMemory.mapped)) {
         std::cout << "Could not load texture file lunarg.ppm\n";
         exit(-1);
     }
 
-    vkUnmapMemory(info.device, mappableMemory);
-
     VkCommandBufferBeginInfo cmd_buf_info = {};
     cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     cmd_buf_info.pNext = NULL;
@@ -1966,7 +2479,7 @@ void init_image(struct sample_info &info, texture_object &texObj, const char *te
                          VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
         /* No staging resources to free later */
         info.stagingImage = VK_NULL_HANDLE;
-        info.stagingMemory = VK_NULL_HANDLE;
+        info.stagingMemory = device_allocation();
     } else {
         /* The mappable image cannot be our texture, so create an optimally
          * tiled image and blit to it */
@@ -1977,23 +2490,10 @@ void init_image(struct sample_info &info, texture_object &texObj, const char *te
         res = vkCreateImage(info.device, &image_create_info, NULL, &texObj.image);
         assert(res == VK_SUCCESS);
 
-        vkGetImageMemoryRequirements(info.device, texObj.image, &mem_reqs);
-
-        mem_alloc.allocationSize = mem_reqs.size;
-
-        /* Find memory type - dont specify any mapping requirements */
-        pass = memory_type_from_properties(info, mem_reqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                           &mem_alloc.memoryTypeIndex);
+        /* Allocate and bind memory - dont specify any mapping requirements */
+        pass = device_alloc_image(info, texObj.image, VK_IMAGE_TILING_OPTIMAL, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texObj.mem);
         assert(pass);
 
-        /* allocate memory */
-        res = vkAllocateMemory(info.device, &mem_alloc, NULL, &texObj.mem);
-        assert(res == VK_SUCCESS);
-
-        /* bind memory */
-        res = vkBindImageMemory(info.device, texObj.image, texObj.mem, 0);
-        assert(res == VK_SUCCESS);
-
         /* Since we're going to blit from the mappable image, set its layout to
          * SOURCE_OPTIMAL. Side effect is that this will create info.cmd */
         set_image_layout(info, mappableImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_PREINITIALIZED,
@@ -2062,6 +2562,7 @@ void init_image(struct sample_info &info, texture_object &texObj, const char *te
 
 void init_texture(struct sample_info &info, const char *textureName, VkImageUsageFlags extraUsages,
                   VkFormatFeatureFlags extraFeatures) {
+    TRACE_ZONE("init", __func__);
     struct texture_object texObj;
 
     /* create image */
@@ -2243,13 +2744,244 @@ void init_render_pass_begin_info(struct sample_info &info, VkRenderPassBeginInfo
     rp_begin.pClearValues = nullptr;
 }
 
+void init_frames_in_flight(struct sample_info &info, uint32_t count) {
+    TRACE_ZONE("init", __func__);
+    /* DEPENDS on init_command_buffer(), init_command_buffer_array() and */
+    /* init_command_buffer2_array()                                      */
+    VkResult U_ASSERT_ONLY res;
+
+    info.frames_in_flight.resize(count);
+    info.current_frame = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        frame_slot &slot = info.frames_in_flight[i];
+
+        // Signaled, so the first wait on each slot returns straight away
+        VkFenceCreateInfo fence_info;
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fence_info.pNext = NULL;
+        fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        res = vkCreateFence(info.device, &fence_info, NULL, &slot.fence);
+        assert(res == VK_SUCCESS);
+
+        VkSemaphoreCreateInfo semaphore_info;
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphore_info.pNext = NULL;
+        semaphore_info.flags = 0;
+        res = vkCreateSemaphore(info.device, &semaphore_info, NULL, &slot.image_acquired);
+        assert(res == VK_SUCCESS);
+        res = vkCreateSemaphore(info.device, &semaphore_info, NULL, &slot.render_complete);
+        assert(res == VK_SUCCESS);
+
+        // The first slot records into the sample's own command buffers
+        if (i == 0) {
+            slot.cmd = info.cmd;
+            slot.cmds = info.cmds;
+            slot.cmd2s = info.cmd2s;
+            continue;
+        }
+
+        slot.cmds.resize(info.cmds.size());
+        slot.cmd2s.resize(info.cmd2s.size());
+
+        VkCommandBufferAllocateInfo cmd = {};
+        cmd.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmd.pNext = NULL;
+        cmd.commandPool = info.cmd_pool;
+        cmd.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        cmd.commandBufferCount = 1;
+        res = vkAllocateCommandBuffers(info.device, &cmd, &slot.cmd);
+        assert(res == VK_SUCCESS);
+
+        cmd.commandBufferCount = slot.cmds.size();
+        res = vkAllocateCommandBuffers(info.device, &cmd, slot.cmds.data());
+        assert(res == VK_SUCCESS);
+
+        cmd.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        cmd.commandBufferCount = slot.cmd2s.size();
+        res = vkAllocateCommandBuffers(info.device, &cmd, slot.cmd2s.data());
+        assert(res == VK_SUCCESS);
+    }
+}
+
+void execute_wait_frames_in_flight(struct sample_info &info) {
+    VkResult U_ASSERT_ONLY res;
+
+    for (uint32_t i = 0; i < info.frames_in_flight.size(); i++) {
+        do {
+            res = vkWaitForFences(info.device, 1, &info.frames_in_flight[i].fence, VK_TRUE, FENCE_TIMEOUT);
+        } while (res == VK_TIMEOUT);
+        assert(res == VK_SUCCESS);
+    }
+}
+
+void init_timestamp_queries(struct sample_info &info, uint32_t slot_count) {
+    TRACE_ZONE("init", __func__);
+    /* DEPENDS on init_device() */
+    VkResult U_ASSERT_ONLY res;
+
+    info.timestamps.pool = VK_NULL_HANDLE;
+    info.timestamps.slot_count = 0;
+    info.timestamps.pending.clear();
+
+    uint32_t valid_bits = info.queue_props[info.graphics_queue_family_index].timestampValidBits;
+    if (valid_bits == 0) {
+        std::cout << "The graphics queue does not support timestamps, GPU times will not be reported\n";
+        return;
+    }
+    info.timestamps.valid_mask = valid_bits >= 64 ? UINT64_MAX : (1ull << valid_bits) - 1;
+    info.timestamps.period = info.gpu_props.limits.timestampPeriod;
+
+    VkQueryPoolCreateInfo query_pool_info = {};
+    query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_pool_info.pNext = NULL;
+    query_pool_info.flags = 0;
+    query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    query_pool_info.queryCount = 2 * slot_count;
+    query_pool_info.pipelineStatistics = 0;
+
+    res = vkCreateQueryPool(info.device, &query_pool_info, NULL, &info.timestamps.pool);
+    assert(res == VK_SUCCESS);
+
+    info.timestamps.slot_count = slot_count;
+    info.timestamps.pending.assign(slot_count, false);
+}
+
+void execute_begin_timestamp_query(struct sample_info &info, VkCommandBuffer cmd) {
+    /* Must be recorded outside of a render pass, before the first one */
+    if (info.timestamps.pool == VK_NULL_HANDLE) return;
+
+    // Whatever the slot held before is discarded.  The slot is marked here
+    // rather than at the end query so that only one recording thread writes it
+    uint32_t first_query = 2 * info.current_frame;
+    info.timestamps.pending[info.current_frame] = true;
+    vkCmdResetQueryPool(cmd, info.timestamps.pool, first_query, 2);
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, info.timestamps.pool, first_query);
+}
+
+void execute_end_timestamp_query(struct sample_info &info, VkCommandBuffer cmd) {
+    /* Must be recorded outside of a render pass, after the last one */
+    if (info.timestamps.pool == VK_NULL_HANDLE) return;
+
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, info.timestamps.pool, 2 * info.current_frame + 1);
+}
+
+bool execute_read_timestamp_query(struct sample_info &info, uint32_t slot, bool wait, uint64_t &gpu_time_ns) {
+    if (info.timestamps.pool == VK_NULL_HANDLE || !info.timestamps.pending[slot]) return false;
+
+    // Each query is followed by its availability word, so without the wait
+    // bit a frame that has not finished yet is simply skipped
+    uint64_t data[4];
+    VkQueryResultFlags flags = VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT;
+    if (wait) flags |= VK_QUERY_RESULT_WAIT_BIT;
+
+    VkResult res = vkGetQueryPoolResults(info.device, info.timestamps.pool, 2 * slot, 2, sizeof(data), data,
+                                         2 * sizeof(uint64_t), flags);
+    if (res != VK_SUCCESS || !data[1] || !data[3]) return false;
+
+    info.timestamps.pending[slot] = false;
+    uint64_t ticks = (data[2] - data[0]) & info.timestamps.valid_mask;
+    gpu_time_ns = (uint64_t)(ticks * (double)info.timestamps.period);
+    return true;
+}
+
+void init_pipeline_statistics_queries(struct sample_info &info, uint32_t queries_per_frame, uint32_t frame_count) {
+    TRACE_ZONE("init", __func__);
+    /* DEPENDS on init_device() */
+    VkResult U_ASSERT_ONLY res;
+
+    info.pipeline_stats_pool = VK_NULL_HANDLE;
+    info.pipeline_stats_queries_per_frame = queries_per_frame;
+    info.pipeline_stats_query_count = 0;
+    if (!info.benchmark_pipeline_stats) return;
+
+    VkQueryPoolCreateInfo query_pool_info = {};
+    query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_pool_info.pNext = NULL;
+    query_pool_info.flags = 0;
+    query_pool_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    query_pool_info.queryCount = queries_per_frame * frame_count;
+    query_pool_info.pipelineStatistics = PIPELINE_STATISTICS_FLAGS;
+
+    res = vkCreateQueryPool(info.device, &query_pool_info, NULL, &info.pipeline_stats_pool);
+    assert(res == VK_SUCCESS);
+}
+
+void execute_begin_pipeline_statistics_query(struct sample_info &info, VkCommandBuffer cmd, uint32_t query) {
+    /* Must be recorded outside of a render pass */
+    if (info.pipeline_stats_pool == VK_NULL_HANDLE) return;
+
+    query += info.current_frame * info.pipeline_stats_queries_per_frame;
+    vkCmdResetQueryPool(cmd, info.pipeline_stats_pool, query, 1);
+    vkCmdBeginQuery(cmd, info.pipeline_stats_pool, query, 0);
+}
+
+void execute_end_pipeline_statistics_query(struct sample_info &info, VkCommandBuffer cmd, uint32_t query) {
+    /* Must be recorded outside of a render pass */
+    if (info.pipeline_stats_pool == VK_NULL_HANDLE) return;
+
+    vkCmdEndQuery(cmd, info.pipeline_stats_pool, query + info.current_frame * info.pipeline_stats_queries_per_frame);
+}
+
+bool execute_read_pipeline_statistics(struct sample_info &info, uint32_t frame, uint32_t query_count,
+                                      uint64_t *statistics) {
+    /* statistics holds PIPELINE_STATISTICS_COUNT counters, summed over the */
+    /* first query_count queries of the frame in flight                     */
+    if (info.pipeline_stats_pool == VK_NULL_HANDLE || query_count == 0) return false;
+
+    std::vector<uint64_t> data(query_count * PIPELINE_STATISTICS_COUNT);
+    VkResult res = vkGetQueryPoolResults(info.device, info.pipeline_stats_pool,
+                                         frame * info.pipeline_stats_queries_per_frame, query_count,
+                                         data.size() * sizeof(uint64_t), data.data(),
+                                         PIPELINE_STATISTICS_COUNT * sizeof(uint64_t),
+                                         VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    if (res != VK_SUCCESS) return false;
+
+    for (uint32_t i = 0; i < PIPELINE_STATISTICS_COUNT; i++) statistics[i] = 0;
+    for (uint32_t q = 0; q < query_count; q++) {
+        for (uint32_t i = 0; i < PIPELINE_STATISTICS_COUNT; i++) statistics[i] += data[q * PIPELINE_STATISTICS_COUNT + i];
+    }
+    return true;
+}
+
+void destroy_pipeline_statistics_queries(struct sample_info &info) {
+    if (info.pipeline_stats_pool != VK_NULL_HANDLE) vkDestroyQueryPool(info.device, info.pipeline_stats_pool, NULL);
+    info.pipeline_stats_pool = VK_NULL_HANDLE;
+}
+
+void destroy_frames_in_flight(struct sample_info &info) {
+    execute_wait_frames_in_flight(info);
+
+    for (uint32_t i = 0; i < info.frames_in_flight.size(); i++) {
+        frame_slot &slot = info.frames_in_flight[i];
+        vkDestroyFence(info.device, slot.fence, NULL);
+        vkDestroySemaphore(info.device, slot.image_acquired, NULL);
+        vkDestroySemaphore(info.device, slot.render_complete, NULL);
+        // The first slot's command buffers belong to the sample
+        if (i > 0) {
+            vkFreeCommandBuffers(info.device, info.cmd_pool, 1, &slot.cmd);
+            vkFreeCommandBuffers(info.device, info.cmd_pool, slot.cmds.size(), slot.cmds.data());
+            vkFreeCommandBuffers(info.device, info.cmd_pool, slot.cmd2s.size(), slot.cmd2s.data());
+        }
+    }
+    info.frames_in_flight.clear();
+}
+
+void destroy_timestamp_queries(struct sample_info &info) {
+    if (info.timestamps.pool != VK_NULL_HANDLE) vkDestroyQueryPool(info.device, info.timestamps.pool, NULL);
+    info.timestamps.pool = VK_NULL_HANDLE;
+}
+
 void destroy_pipeline(struct sample_info &info) { vkDestroyPipeline(info.device, info.pipeline, NULL); }
 
 void destroy_pipeline_cache(struct sample_info &info) { vkDestroyPipelineCache(info.device, info.pipelineCache, NULL); }
 
-void destroy_uniform_buffer(struct sample_info &info) {
-    vkDestroyBuffer(info.device, info.uniform_data.buf, NULL);
-    vkFreeMemory(info.device, info.uniform_data.mem, NULL);
+void destroy_uniform_buffer(struct sample_info &info) { destroy_uniform_ring(info, info.uniform_data); }
+
+void destroy_uniform_ring(struct sample_info &info, uniform_ring &ring) {
+    ring.mapped = NULL;
+    vkDestroyBuffer(info.device, ring.buf, NULL);
+    device_free(info, ring.mem);
 }
 
 void destroy_descriptor_and_pipeline_layouts(struct sample_info &info) {
@@ -2262,6 +2994,7 @@ void destroy_descriptor_pool(struct sample_info &info) { vkDestroyDescriptorPool
 void destroy_shaders(struct sample_info &info) {
     vkDestroyShaderModule(info.device, info.shaderStages[0].module, NULL);
     vkDestroyShaderModule(info.device, info.shaderStages[1].module, NULL);
+    vkDestroyShaderModule(info.device, info.push_constant_stage.module, NULL);
 }
 
 void destroy_command_buffer(struct sample_info &info) {
@@ -2271,7 +3004,8 @@ void destroy_command_buffer(struct sample_info &info) {
 
 
 void destroy_command_buffer_array(struct sample_info &info) {
-    vkFreeCommandBuffers(info.device, info.cmd_pool, NUM_BUFFERS, info.cmds);
+    vkFreeCommandBuffers(info.device, info.cmd_pool, info.cmds.size(), info.cmds.data());
+    info.cmds.clear();
 }
 
 void destroy_command_buffer2(struct sample_info &info){
@@ -2280,7 +3014,8 @@ void destroy_command_buffer2(struct sample_info &info){
 }
 
 void destroy_command_buffer2_array(struct sample_info &info){
-  vkFreeCommandBuffers(info.device, info.cmd_pool, NUM_BUFFERS, info.cmd2s);
+  vkFreeCommandBuffers(info.device, info.cmd_pool, info.cmd2s.size(), info.cmd2s.data());
+  info.cmd2s.clear();
 }
 
 void destroy_command_pool(struct sample_info &info) { vkDestroyCommandPool(info.device, info.cmd_pool, NULL); }
@@ -2288,19 +3023,37 @@ void destroy_command_pool(struct sample_info &info) { vkDestroyCommandPool(info.
 void destroy_depth_buffer(struct sample_info &info) {
     vkDestroyImageView(info.device, info.depth.view, NULL);
     vkDestroyImage(info.device, info.depth.image, NULL);
-    vkFreeMemory(info.device, info.depth.mem, NULL);
+    device_free(info, info.depth.mem);
 }
 
 void destroy_vertex_buffer(struct sample_info &info) {
     vkDestroyBuffer(info.device, info.vertex_buffer.buf, NULL);
-    vkFreeMemory(info.device, info.vertex_buffer.mem, NULL);
+    device_free(info, info.vertex_buffer.mem);
+}
+
+void destroy_instance_buffer(struct sample_info &info) {
+    vkDestroyBuffer(info.device, info.instance_buffer.buf, NULL);
+    device_free(info, info.instance_buffer.mem);
+    info.instance_buffer.buf = VK_NULL_HANDLE;
+    info.instance_count = 0;
+}
+
+void destroy_index_buffer(struct sample_info &info) {
+    vkDestroyBuffer(info.device, info.index_buffer.buf, NULL);
+    device_free(info, info.index_buffer.mem);
+    info.index_buffer.buf = VK_NULL_HANDLE;
+    info.index_count = 0;
 }
 
 void destroy_swap_chain(struct sample_info &info) {
     for (uint32_t i = 0; i < info.swapchainImageCount; i++) {
         vkDestroyImageView(info.device, info.buffers[i].view, NULL);
+        if (info.headless) {
+            vkDestroyImage(info.device, info.buffers[i].image, NULL);
+            device_free(info, info.buffers[i].mem);
+        }
     }
-    vkDestroySwapchainKHR(info.device, info.swap_chain, NULL);
+    if (!info.headless) vkDestroySwapchainKHR(info.device, info.swap_chain, NULL);
 }
 
 void destroy_framebuffers(struct sample_info &info) {
@@ -2314,22 +3067,25 @@ void destroy_renderpass(struct sample_info &info) { vkDestroyRenderPass(info.dev
 
 void destroy_device(struct sample_info &info) {
     vkDeviceWaitIdle(info.device);
+    destroy_device_allocator(info);
     vkDestroyDevice(info.device, NULL);
 }
 
-void destroy_instance(struct sample_info &info) { vkDestroyInstance(info.inst, NULL); }
+void destroy_instance(struct sample_info &info) {
+    vkDestroyInstance(info.inst, NULL);
+    // Last teardown call of every sample, so the trace covers the whole run
+    write_trace();
+}
 
 void destroy_textures(struct sample_info &info) {
     for (size_t i = 0; i < info.textures.size(); i++) {
         vkDestroySampler(info.device, info.textures[i].sampler, NULL);
         vkDestroyImageView(info.device, info.textures[i].view, NULL);
         vkDestroyImage(info.device, info.textures[i].image, NULL);
-        vkFreeMemory(info.device, info.textures[i].mem, NULL);
+        device_free(info, info.textures[i].mem);
     }
     if (info.stagingImage) {
         vkDestroyImage(info.device, info.stagingImage, NULL);
     }
-    if (info.stagingMemory) {
-        vkFreeMemory(info.device, info.stagingMemory, NULL);
-    }
+    device_free(info, info.stagingMemory);
 }
@@ -65,23 +65,49 @@ void init_swap_chain(
                                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
 void init_depth_buffer(struct sample_info &info);
 void init_uniform_buffer(struct sample_info &info);
-void update_uniform_buffer(struct sample_info &info);
+/* Writes info.MVP into the frame's slot and returns its dynamic offset */
+uint32_t update_uniform_buffer(struct sample_info &info);
+/* Dynamic offset of the frame's slot, for binding info.desc_set */
+uint32_t get_uniform_buffer_offset(struct sample_info &info);
+/* A dedicated ring gets unmapped memory of its own, for callers that map it themselves */
+void init_uniform_ring(struct sample_info &info, uniform_ring &ring, VkDeviceSize range, uint32_t slot_count,
+                       bool dedicated = false);
+uint32_t write_uniform_ring(struct sample_info &info, uniform_ring &ring, uint32_t slot, const void *data);
 void init_descriptor_and_pipeline_layouts(struct sample_info &info, bool use_texture,
-                                          VkDescriptorSetLayoutCreateFlags descSetLayoutCreateFlags = 0);
+                                          VkDescriptorSetLayoutCreateFlags descSetLayoutCreateFlags = 0,
+                                          uint32_t pushConstantSize = 0,
+                                          VkDescriptorType uniformType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
 void init_renderpass(
     struct sample_info &info, bool include_depth, bool clear = true,
     VkImageLayout finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+/* Same render pass with the given ops on the color and depth attachments */
+void init_renderpass_ops(struct sample_info &info, bool include_depth, VkAttachmentLoadOp loadOp,
+                         VkAttachmentStoreOp storeOp, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+/*
+ * Copies size bytes from src to dst, on the transfer queue when the device
+ * has one and use_transfer_queue is set, and waits for it.  dst ends up
+ * owned by the graphics queue family and visible to the reads its usage
+ * allows.  On the transfer queue, neither may have been used by the
+ * graphics queue before.
+ */
+void execute_copy_buffer(struct sample_info &info, VkBuffer src, VkBuffer dst, VkDeviceSize size,
+                         VkBufferUsageFlags dst_usage, bool use_transfer_queue = true);
+/* A DEVICE_LOCAL buffer filled with data through a staging buffer */
+void init_device_local_buffer(struct sample_info &info, VkBufferUsageFlags usage, const void *data, VkDeviceSize size,
+                              VkBuffer &buf, device_allocation &mem);
 void init_vertex_buffer(struct sample_info &info, const void *vertexData,
                         uint32_t dataSize, uint32_t dataStride,
                         bool use_texture);
+void init_instance_buffer(struct sample_info &info, const glm::mat4 *transforms, uint32_t count);
 void init_framebuffers(struct sample_info &info, bool include_depth);
 void init_descriptor_pool(struct sample_info &info, bool use_texture);
 void init_descriptor_set(struct sample_info &info, bool use_texture);
 void init_shaders(struct sample_info &info, const char *vertShaderText,
                   const char *fragShaderText);
+void init_push_constant_shader(struct sample_info &info, const char *vertShaderText);
 void init_pipeline_cache(struct sample_info &info);
 void init_pipeline(struct sample_info &info, VkBool32 include_depth,
-                   VkBool32 include_vi = true);
+                   VkBool32 include_vi = true, VkBool32 use_push_constants = false);
 void init_sampler(struct sample_info &info, VkSampler &sampler);
 void init_image(struct sample_info &info, texture_object &texObj,
                 const char *textureName, VkImageUsageFlags extraUsages = 0,
@@ -107,6 +133,27 @@ void init_render_pass_begin_info(struct sample_info &info,
                                  VkRenderPassBeginInfo &rp_begin);
 void init_window_size(struct sample_info &info, int32_t default_width,
                       int32_t default_height);
+void init_frames_in_flight(struct sample_info &info, uint32_t count);
+void execute_wait_frames_in_flight(struct sample_info &info);
+void init_timestamp_queries(struct sample_info &info, uint32_t slot_count);
+void execute_begin_timestamp_query(struct sample_info &info,
+                                   VkCommandBuffer cmd);
+void execute_end_timestamp_query(struct sample_info &info,
+                                 VkCommandBuffer cmd);
+bool execute_read_timestamp_query(struct sample_info &info, uint32_t slot,
+                                  bool wait, uint64_t &gpu_time_ns);
+void init_pipeline_statistics_queries(struct sample_info &info,
+                                      uint32_t queries_per_frame,
+                                      uint32_t frame_count);
+void execute_begin_pipeline_statistics_query(struct sample_info &info,
+                                             VkCommandBuffer cmd,
+                                             uint32_t query);
+void execute_end_pipeline_statistics_query(struct sample_info &info,
+                                           VkCommandBuffer cmd,
+                                           uint32_t query);
+bool execute_read_pipeline_statistics(struct sample_info &info,
+                                      uint32_t frame, uint32_t query_count,
+                                      uint64_t *statistics);
 
 VkResult init_debug_report_callback(struct sample_info &info,
                                     PFN_vkDebugReportCallbackEXT dbgFunc);
@@ -115,12 +162,15 @@ void destroy_pipeline(struct sample_info &info);
 void destroy_pipeline_cache(struct sample_info &info);
 void destroy_descriptor_pool(struct sample_info &info);
 void destroy_vertex_buffer(struct sample_info &info);
+void destroy_index_buffer(struct sample_info &info);
+void destroy_instance_buffer(struct sample_info &info);
 void destroy_textures(struct sample_info &info);
 void destroy_framebuffers(struct sample_info &info);
 void destroy_shaders(struct sample_info &info);
 void destroy_renderpass(struct sample_info &info);
 void destroy_descriptor_and_pipeline_layouts(struct sample_info &info);
 void destroy_uniform_buffer(struct sample_info &info);
+void destroy_uniform_ring(struct sample_info &info, uniform_ring &ring);
 void destroy_depth_buffer(struct sample_info &info);
 void destroy_swap_chain(struct sample_info &info);
 void destroy_command_buffer(struct sample_info &info);
@@ -128,6 +178,9 @@ void destroy_command_buffer2(struct sample_info &info);
 void destroy_command_buffer_array(struct sample_info &info);
 void destroy_command_buffer2_array(struct sample_info &info);
 void destroy_command_pool(struct sample_info &info);
+void destroy_frames_in_flight(struct sample_info &info);
+void destroy_timestamp_queries(struct sample_info &info);
+void destroy_pipeline_statistics_queries(struct sample_info &info);
 void destroy_device(struct sample_info &info);
 void destroy_instance(struct sample_info &info);
 void destroy_window(struct sample_info &info);
@@ -27,6 +27,7 @@ from dispatch_table_helper_generator import DispatchTableHelperOutputGenerator,
 from helper_file_generator import HelperFileOutputGenerator, HelperFileOutputGeneratorOptions
 from loader_extension_generator import LoaderExtensionOutputGenerator, LoaderExtensionGeneratorOptions
 from mock_icd_generator import MockICDGeneratorOptions, MockICDOutputGenerator
+from profiling_layer_generator import ProfilingLayerGeneratorOptions, ProfilingLayerOutputGenerator
 
 # Simple timer functions
 startTime = None
@@ -490,6 +491,27 @@ def makeGenOpts(extensions = [], removeExtensions = [], protect = True, director
             helper_file_type  = 'mock_icd_source')
         ]
 
+    # Options for profiling layer
+    genOpts['profiling_layer.cpp'] = [
+          ProfilingLayerOutputGenerator,
+          ProfilingLayerGeneratorOptions(
+            filename          = 'profiling_layer.cpp',
+            directory         = directory,
+            apiname           = 'vulkan',
+            profile           = None,
+            versions          = allVersions,
+            emitversions      = allVersions,
+            defaultExtensions = 'vulkan',
+            addExtensions     = addExtensions,
+            removeExtensions  = removeExtensions,
+            prefixText        = prefixStrings + vkPrefixStrings,
+            protectFeature    = False,
+            apicall           = 'VKAPI_ATTR ',
+            apientry          = 'VKAPI_CALL ',
+            apientryp         = 'VKAPI_PTR *',
+            alignFuncParam    = 48)
+        ]
+
 # Generate a target based on the options in the matching genOpts{} object.
 # This is encapsulated in a function so it can be profiled and/or timed.
 # The args parameter is an parsed argument object containing the following
@@ -0,0 +1,686 @@
+#!/usr/bin/python3 -i
+#
+# Copyright (c) 2015-2017 The Khronos Group Inc.
+# Copyright (c) 2015-2017 Valve Corporation
+# Copyright (c) 2015-2017 LunarG, Inc.
+# Copyright (c) 2015-2017 Google Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# This script generates a profiling layer that intercepts every Vulkan
+#  entrypoint with a dispatchable first parameter. Each thread counts its
+#  own calls, and with VK_PROFILING_SAMPLE_PERIOD=<n> also times every
+#  n-th call it makes. A per-frame (frames end at vkQueuePresentKHR) and
+#  per-run summary is written at vkDestroyDevice, to stdout or appended
+#  to VK_PROFILING_OUTPUT. With sampling off a call
+#  costs a dispatch lookup and one uncontended counter update, so the
+#  layer can stay enabled in long runs.
+
+import os,re,sys
+from generator import *
+
+# Manual code at the top of the cpp source file
+SOURCE_CPP_PREFIX = '''
+static const VkLayerProperties global_layer = {
+    "VK_LAYER_SAMPLES_profiling", VK_MAKE_VERSION(1, 0, VK_HEADER_VERSION), 1, "Samples API call profiling layer",
+};
+
+// Dispatch tables of one instance or device, found through the dispatch key of its handles
+struct layer_data {
+    VkInstance instance;
+    VkLayerInstanceDispatchTable instance_dispatch_table;
+    VkLayerDispatchTable device_dispatch_table;
+};
+
+// Instances and devices alive at once, every call scans them so keep it small
+static const uint32_t MAX_DISPATCH_KEYS = 16;
+
+struct dispatch_entry {
+    std::atomic<void *> key;
+    layer_data *data;
+};
+
+static dispatch_entry dispatch_entries[MAX_DISPATCH_KEYS];
+static std::mutex dispatch_lock;  // Serializes adding and removing entries, lookups take no lock
+
+static inline void *get_dispatch_key(const void *object) { return *(void **)object; }
+
+static inline layer_data *get_layer_data(const void *object) {
+    void *key = get_dispatch_key(object);
+    for (uint32_t i = 0; i < MAX_DISPATCH_KEYS; i++) {
+        if (dispatch_entries[i].key.load(std::memory_order_acquire) == key) return dispatch_entries[i].data;
+    }
+    return nullptr;
+}
+
+static bool add_layer_data(const void *object, layer_data *data) {
+    std::lock_guard<std::mutex> lock(dispatch_lock);
+    for (uint32_t i = 0; i < MAX_DISPATCH_KEYS; i++) {
+        if (dispatch_entries[i].key.load(std::memory_order_relaxed) == nullptr) {
+            dispatch_entries[i].data = data;
+            dispatch_entries[i].key.store(get_dispatch_key(object), std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void remove_layer_data(const void *object) {
+    std::lock_guard<std::mutex> lock(dispatch_lock);
+    void *key = get_dispatch_key(object);
+    for (uint32_t i = 0; i < MAX_DISPATCH_KEYS; i++) {
+        if (dispatch_entries[i].key.load(std::memory_order_relaxed) == key) {
+            dispatch_entries[i].key.store(nullptr, std::memory_order_release);
+            delete dispatch_entries[i].data;
+            dispatch_entries[i].data = nullptr;
+            return;
+        }
+    }
+}
+
+static uint32_t sample_period = 0;  // VK_PROFILING_SAMPLE_PERIOD, 0 only counts calls
+static std::string output_path;     // VK_PROFILING_OUTPUT, stdout when empty
+static bool settings_read = false;
+
+// Counters of one thread.  Only the owning thread writes them, so an update is
+// a relaxed load and store rather than a locked read-modify-write, and the
+// report reads them from another thread without stopping anyone.
+struct thread_profile {
+    uint32_t index;
+    uint32_t countdown;  // Calls left until the next sample
+    std::atomic<uint64_t> calls[COMMAND_COUNT];
+    std::atomic<uint64_t> samples[COMMAND_COUNT];
+    std::atomic<uint64_t> sampled_ns[COMMAND_COUNT];
+    // What the last report covered, guarded by profile_lock
+    uint64_t reported_calls[COMMAND_COUNT];
+    uint64_t reported_samples[COMMAND_COUNT];
+    uint64_t reported_sampled_ns[COMMAND_COUNT];
+};
+
+static std::mutex profile_lock;
+static std::vector<thread_profile *> thread_profiles;  // Kept after their thread exits, for the report
+static thread_local thread_profile *current_thread_profile = nullptr;
+
+struct frame_profile {
+    uint64_t count;
+    uint64_t last_present_ns;
+    uint64_t sum_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+};
+
+static std::mutex frame_lock;
+static frame_profile frames = {};
+
+static inline uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void read_settings() {
+    std::lock_guard<std::mutex> lock(profile_lock);
+    if (settings_read) return;
+    settings_read = true;
+    const char *period = getenv("VK_PROFILING_SAMPLE_PERIOD");
+    if (period) sample_period = (uint32_t)strtoul(period, nullptr, 10);
+    const char *output = getenv("VK_PROFILING_OUTPUT");
+    if (output) output_path = output;
+}
+
+static thread_profile *register_thread() {
+    thread_profile *profile = new thread_profile();
+    std::lock_guard<std::mutex> lock(profile_lock);
+    profile->index = (uint32_t)thread_profiles.size();
+    profile->countdown = sample_period;
+    thread_profiles.push_back(profile);
+    current_thread_profile = profile;
+    return profile;
+}
+
+static inline void add_counter(std::atomic<uint64_t> &counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+// Counts the call, and returns its start time when this thread samples it or 0
+static inline uint64_t begin_call(thread_profile *&profile, uint32_t command) {
+    profile = current_thread_profile;
+    if (!profile) profile = register_thread();
+    add_counter(profile->calls[command], 1);
+    if (sample_period == 0 || --profile->countdown != 0) return 0;
+    profile->countdown = sample_period;
+    return now_ns();
+}
+
+static inline void end_call(thread_profile *profile, uint32_t command, uint64_t start_ns) {
+    if (start_ns == 0) return;
+    add_counter(profile->samples[command], 1);
+    add_counter(profile->sampled_ns[command], now_ns() - start_ns);
+}
+
+// Frames end at vkQueuePresentKHR
+static void end_frame() {
+    uint64_t present_ns = now_ns();
+    std::lock_guard<std::mutex> lock(frame_lock);
+    if (frames.count > 0) {
+        uint64_t frame_ns = present_ns - frames.last_present_ns;
+        frames.sum_ns += frame_ns;
+        if (frames.count == 1 || frame_ns < frames.min_ns) frames.min_ns = frame_ns;
+        if (frame_ns > frames.max_ns) frames.max_ns = frame_ns;
+    }
+    frames.count++;
+    frames.last_present_ns = present_ns;
+}
+
+struct command_summary {
+    uint32_t command;
+    uint64_t calls;
+    uint64_t samples;
+    uint64_t sampled_ns;
+    // Mean of the sampled calls times every call, 0 without samples
+    double estimated_ns() const { return samples ? (double)sampled_ns / samples * calls : 0.0; }
+};
+
+/*
+ * Writes what happened since the last report, so each device reports its own
+ * run as long as devices are not alive at the same time
+ */
+static void write_report(const char *reason) {
+    std::vector<command_summary> commands(COMMAND_COUNT);
+    for (uint32_t i = 0; i < COMMAND_COUNT; i++) commands[i] = {i, 0, 0, 0};
+    std::vector<command_summary> threads;
+
+    {
+        std::lock_guard<std::mutex> lock(profile_lock);
+        for (thread_profile *profile : thread_profiles) {
+            command_summary thread_total = {profile->index, 0, 0, 0};
+            double thread_estimated_ns = 0.0;
+            for (uint32_t i = 0; i < COMMAND_COUNT; i++) {
+                uint64_t calls = profile->calls[i].load(std::memory_order_relaxed);
+                uint64_t samples = profile->samples[i].load(std::memory_order_relaxed);
+                uint64_t sampled_ns = profile->sampled_ns[i].load(std::memory_order_relaxed);
+                command_summary delta = {i, calls - profile->reported_calls[i], samples - profile->reported_samples[i],
+                                         sampled_ns - profile->reported_sampled_ns[i]};
+                profile->reported_calls[i] = calls;
+                profile->reported_samples[i] = samples;
+                profile->reported_sampled_ns[i] = sampled_ns;
+                commands[i].calls += delta.calls;
+                commands[i].samples += delta.samples;
+                commands[i].sampled_ns += delta.sampled_ns;
+                thread_total.calls += delta.calls;
+                thread_total.samples += delta.samples;
+                thread_estimated_ns += delta.estimated_ns();
+            }
+            // Threads report their estimated time through sampled_ns, already scaled to every call
+            thread_total.sampled_ns = (uint64_t)thread_estimated_ns;
+            if (thread_total.calls) threads.push_back(thread_total);
+        }
+    }
+
+    frame_profile run_frames;
+    {
+        std::lock_guard<std::mutex> lock(frame_lock);
+        run_frames = frames;
+        frames = {};
+    }
+
+    // Most expensive first when timed, most called first otherwise
+    std::sort(commands.begin(), commands.end(), [](const command_summary &a, const command_summary &b) {
+        if (a.estimated_ns() != b.estimated_ns()) return a.estimated_ns() > b.estimated_ns();
+        return a.calls > b.calls;
+    });
+
+    FILE *out = output_path.empty() ? stdout : fopen(output_path.c_str(), "a");
+    if (!out) {
+        fprintf(stderr, "%s: cannot open %s, reporting to stdout\\n", global_layer.layerName, output_path.c_str());
+        out = stdout;
+    }
+
+    double per_frame = run_frames.count ? 1.0 / run_frames.count : 0.0;
+    uint64_t frame_intervals = run_frames.count > 1 ? run_frames.count - 1 : 0;
+    fprintf(out, "%s summary at %s\\n", global_layer.layerName, reason);
+    if (sample_period) {
+        fprintf(out, "sampling 1 in %u calls per thread, times are estimated from the samples\\n",
+                sample_period);
+    } else {
+        fprintf(out, "sampling off (set VK_PROFILING_SAMPLE_PERIOD), calls are counted only\\n");
+    }
+    fprintf(out, "frames: %llu", (unsigned long long)run_frames.count);
+    if (frame_intervals) {
+        fprintf(out, ", frame ms mean %.3f min %.3f max %.3f", run_frames.sum_ns / 1e6 / frame_intervals,
+                run_frames.min_ns / 1e6, run_frames.max_ns / 1e6);
+    }
+    fprintf(out, "\\n");
+
+    fprintf(out, "%-48s %12s %12s %10s %12s %12s %12s\\n", "entrypoint", "calls", "calls/frame", "samples", "mean_us",
+            "est_ms", "est_ms/frame");
+    for (const command_summary &summary : commands) {
+        if (!summary.calls) continue;
+        fprintf(out, "%-48s %12llu %12.2f %10llu", command_names[summary.command], (unsigned long long)summary.calls,
+                summary.calls * per_frame, (unsigned long long)summary.samples);
+        if (summary.samples) {
+            fprintf(out, " %12.3f %12.3f %12.4f\\n", (double)summary.sampled_ns / summary.samples / 1e3,
+                    summary.estimated_ns() / 1e6, summary.estimated_ns() / 1e6 * per_frame);
+        } else {
+            fprintf(out, " %12s %12s %12s\\n", "-", "-", "-");
+        }
+    }
+
+    fprintf(out, "%-48s %12s %12s %10s %12s\\n", "thread", "calls", "calls/frame", "samples", "est_ms");
+    for (const command_summary &summary : threads) {
+        fprintf(out, "thread %-41u %12llu %12.2f %10llu", summary.command, (unsigned long long)summary.calls,
+                summary.calls * per_frame, (unsigned long long)summary.samples);
+        if (summary.samples) {
+            fprintf(out, " %12.3f\\n", summary.sampled_ns / 1e6);
+        } else {
+            fprintf(out, " %12s\\n", "-");
+        }
+    }
+    fprintf(out, "\\n");
+    fflush(out);
+    if (out != stdout) fclose(out);
+}
+
+static VkLayerInstanceCreateInfo *get_chain_info(const VkInstanceCreateInfo *pCreateInfo, VkLayerFunction func) {
+    VkLayerInstanceCreateInfo *chain_info = (VkLayerInstanceCreateInfo *)pCreateInfo->pNext;
+    while (chain_info && !(chain_info->sType == VK_STRUCTURE_TYPE_LOADER_INSTANCE_CREATE_INFO && chain_info->function == func)) {
+        chain_info = (VkLayerInstanceCreateInfo *)chain_info->pNext;
+    }
+    return chain_info;
+}
+
+static VkLayerDeviceCreateInfo *get_chain_info(const VkDeviceCreateInfo *pCreateInfo, VkLayerFunction func) {
+    VkLayerDeviceCreateInfo *chain_info = (VkLayerDeviceCreateInfo *)pCreateInfo->pNext;
+    while (chain_info && !(chain_info->sType == VK_STRUCTURE_TYPE_LOADER_DEVICE_CREATE_INFO && chain_info->function == func)) {
+        chain_info = (VkLayerDeviceCreateInfo *)chain_info->pNext;
+    }
+    return chain_info;
+}
+'''
+
+# Manual code at the end of the cpp source file
+SOURCE_CPP_POSTFIX = '''
+static VKAPI_ATTR VkResult VKAPI_CALL CreateInstance(const VkInstanceCreateInfo *pCreateInfo,
+                                                     const VkAllocationCallbacks *pAllocator, VkInstance *pInstance) {
+    VkLayerInstanceCreateInfo *chain_info = get_chain_info(pCreateInfo, VK_LAYER_LINK_INFO);
+    if (!chain_info || !chain_info->u.pLayerInfo) return VK_ERROR_INITIALIZATION_FAILED;
+    PFN_vkGetInstanceProcAddr fpGetInstanceProcAddr = chain_info->u.pLayerInfo->pfnNextGetInstanceProcAddr;
+    PFN_vkCreateInstance fpCreateInstance = (PFN_vkCreateInstance)fpGetInstanceProcAddr(NULL, "vkCreateInstance");
+    if (fpCreateInstance == NULL) return VK_ERROR_INITIALIZATION_FAILED;
+
+    // Advance the link info for the next element on the chain
+    chain_info->u.pLayerInfo = chain_info->u.pLayerInfo->pNext;
+    VkResult result = fpCreateInstance(pCreateInfo, pAllocator, pInstance);
+    if (result != VK_SUCCESS) return result;
+
+    read_settings();
+    layer_data *my_data = new layer_data();
+    my_data->instance = *pInstance;
+    layer_init_instance_dispatch_table(*pInstance, &my_data->instance_dispatch_table, fpGetInstanceProcAddr);
+    if (!add_layer_data(*pInstance, my_data)) {
+        my_data->instance_dispatch_table.DestroyInstance(*pInstance, pAllocator);
+        delete my_data;
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR void VKAPI_CALL DestroyInstance(VkInstance instance, const VkAllocationCallbacks *pAllocator) {
+    if (instance == VK_NULL_HANDLE) return;
+    layer_data *my_data = get_layer_data(instance);
+    my_data->instance_dispatch_table.DestroyInstance(instance, pAllocator);
+    remove_layer_data(instance);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL CreateDevice(VkPhysicalDevice gpu, const VkDeviceCreateInfo *pCreateInfo,
+                                                   const VkAllocationCallbacks *pAllocator, VkDevice *pDevice) {
+    layer_data *instance_data = get_layer_data(gpu);
+    VkLayerDeviceCreateInfo *chain_info = get_chain_info(pCreateInfo, VK_LAYER_LINK_INFO);
+    if (!chain_info || !chain_info->u.pLayerInfo) return VK_ERROR_INITIALIZATION_FAILED;
+    PFN_vkGetInstanceProcAddr fpGetInstanceProcAddr = chain_info->u.pLayerInfo->pfnNextGetInstanceProcAddr;
+    PFN_vkGetDeviceProcAddr fpGetDeviceProcAddr = chain_info->u.pLayerInfo->pfnNextGetDeviceProcAddr;
+    PFN_vkCreateDevice fpCreateDevice = (PFN_vkCreateDevice)fpGetInstanceProcAddr(instance_data->instance, "vkCreateDevice");
+    if (fpCreateDevice == NULL) return VK_ERROR_INITIALIZATION_FAILED;
+
+    // Advance the link info for the next element on the chain
+    chain_info->u.pLayerInfo = chain_info->u.pLayerInfo->pNext;
+    VkResult result = fpCreateDevice(gpu, pCreateInfo, pAllocator, pDevice);
+    if (result != VK_SUCCESS) return result;
+
+    layer_data *my_data = new layer_data();
+    my_data->instance = instance_data->instance;
+    layer_init_device_dispatch_table(*pDevice, &my_data->device_dispatch_table, fpGetDeviceProcAddr);
+    if (!add_layer_data(*pDevice, my_data)) {
+        my_data->device_dispatch_table.DestroyDevice(*pDevice, pAllocator);
+        delete my_data;
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR void VKAPI_CALL DestroyDevice(VkDevice device, const VkAllocationCallbacks *pAllocator) {
+    if (device == VK_NULL_HANDLE) return;
+    layer_data *my_data = get_layer_data(device);
+    my_data->device_dispatch_table.DestroyDevice(device, pAllocator);
+    remove_layer_data(device);
+    write_report("vkDestroyDevice");
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL EnumerateInstanceLayerProperties(uint32_t *pCount, VkLayerProperties *pProperties) {
+    if (pProperties == NULL) {
+        *pCount = 1;
+        return VK_SUCCESS;
+    }
+    if (*pCount < 1) return VK_INCOMPLETE;
+    *pCount = 1;
+    pProperties[0] = global_layer;
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL EnumerateInstanceExtensionProperties(const char *pLayerName, uint32_t *pCount,
+                                                                           VkExtensionProperties *pProperties) {
+    if (pLayerName && !strcmp(pLayerName, global_layer.layerName)) {
+        *pCount = 0;
+        return VK_SUCCESS;
+    }
+    return VK_ERROR_LAYER_NOT_PRESENT;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL EnumerateDeviceLayerProperties(VkPhysicalDevice physicalDevice, uint32_t *pCount,
+                                                                     VkLayerProperties *pProperties) {
+    return EnumerateInstanceLayerProperties(pCount, pProperties);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL EnumerateDeviceExtensionProperties(VkPhysicalDevice physicalDevice, const char *pLayerName,
+                                                                         uint32_t *pCount, VkExtensionProperties *pProperties) {
+    if (pLayerName && !strcmp(pLayerName, global_layer.layerName)) {
+        *pCount = 0;
+        return VK_SUCCESS;
+    }
+    if (physicalDevice == VK_NULL_HANDLE) return VK_ERROR_LAYER_NOT_PRESENT;
+    layer_data *my_data = get_layer_data(physicalDevice);
+    return my_data->instance_dispatch_table.EnumerateDeviceExtensionProperties(physicalDevice, pLayerName, pCount, pProperties);
+}
+
+// Only hands out an intercept when the chain below supports the function, extensions that
+// were not enabled included
+static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL GetDeviceProcAddr(VkDevice device, const char *funcName) {
+    layer_data *my_data = get_layer_data(device);
+    PFN_vkVoidFunction next = my_data->device_dispatch_table.GetDeviceProcAddr(device, funcName);
+    if (next == NULL) return NULL;
+    const auto item = name_to_funcptr_map.find(funcName);
+    if (item != name_to_funcptr_map.end()) return reinterpret_cast<PFN_vkVoidFunction>(item->second);
+    return next;
+}
+
+static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL GetInstanceProcAddr(VkInstance instance, const char *funcName) {
+    const auto item = name_to_funcptr_map.find(funcName);
+    if (instance == VK_NULL_HANDLE) {
+        // Only the global commands can be asked for without an instance
+        return item != name_to_funcptr_map.end() ? reinterpret_cast<PFN_vkVoidFunction>(item->second) : NULL;
+    }
+    layer_data *my_data = get_layer_data(instance);
+    PFN_vkVoidFunction next = my_data->instance_dispatch_table.GetInstanceProcAddr(instance, funcName);
+    if (next == NULL) return NULL;
+    if (item != name_to_funcptr_map.end()) return reinterpret_cast<PFN_vkVoidFunction>(item->second);
+    return next;
+}
+
+} // namespace profiling
+
+// Loader-layer interface
+
+VK_LAYER_EXPORT VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceLayerProperties(uint32_t *pCount,
+                                                                                  VkLayerProperties *pProperties) {
+    return profiling::EnumerateInstanceLayerProperties(pCount, pProperties);
+}
+
+VK_LAYER_EXPORT VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceLayerProperties(VkPhysicalDevice physicalDevice, uint32_t *pCount,
+                                                                                VkLayerProperties *pProperties) {
+    // The layer command handles VK_NULL_HANDLE just fine internally
+    assert(physicalDevice == VK_NULL_HANDLE);
+    return profiling::EnumerateDeviceLayerProperties(VK_NULL_HANDLE, pCount, pProperties);
+}
+
+VK_LAYER_EXPORT VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceExtensionProperties(const char *pLayerName, uint32_t *pCount,
+                                                                                      VkExtensionProperties *pProperties) {
+    return profiling::EnumerateInstanceExtensionProperties(pLayerName, pCount, pProperties);
+}
+
+VK_LAYER_EXPORT VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceExtensionProperties(VkPhysicalDevice physicalDevice,
+                                                                                    const char *pLayerName, uint32_t *pCount,
+                                                                                    VkExtensionProperties *pProperties) {
+    // The layer command handles VK_NULL_HANDLE just fine internally
+    assert(physicalDevice == VK_NULL_HANDLE);
+    return profiling::EnumerateDeviceExtensionProperties(VK_NULL_HANDLE, pLayerName, pCount, pProperties);
+}
+
+VK_LAYER_EXPORT VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(VkDevice dev, const char *funcName) {
+    return profiling::GetDeviceProcAddr(dev, funcName);
+}
+
+VK_LAYER_EXPORT VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(VkInstance instance, const char *funcName) {
+    return profiling::GetInstanceProcAddr(instance, funcName);
+}
+'''
+
+# ProfilingLayerGeneratorOptions - subclass of GeneratorOptions.
+#
+# Adds options used by ProfilingLayerOutputGenerator objects during
+# profiling layer generation.
+#
+# Additional members
+#   prefixText - list of strings to prefix generated source with
+#     (usually a copyright statement + calling convention macros).
+#   protectFeature - True if #ifndef..#endif protection should be
+#     generated around a feature interface in the source file.
+#   apicall - string to use for the function declaration prefix,
+#     such as APICALL on Windows.
+#   apientry - string to use for the calling convention macro,
+#     in typedefs, such as APIENTRY.
+#   apientryp - string to use for the calling convention macro
+#     in function pointer typedefs, such as APIENTRYP.
+#   indentFuncProto - True if prototype declarations should put each
+#     parameter on a separate line
+#   indentFuncPointer - True if typedefed function pointers should put each
+#     parameter on a separate line
+#   alignFuncParam - if nonzero and parameters are being put on a
+#     separate line, align parameter names at the specified column
+class ProfilingLayerGeneratorOptions(GeneratorOptions):
+    def __init__(self,
+                 filename = None,
+                 directory = '.',
+                 apiname = None,
+                 profile = None,
+                 versions = '.*',
+                 emitversions = '.*',
+                 defaultExtensions = None,
+                 addExtensions = None,
+                 removeExtensions = None,
+                 sortProcedure = regSortFeatures,
+                 prefixText = "",
+                 protectFeature = True,
+                 apicall = '',
+                 apientry = '',
+                 apientryp = '',
+                 indentFuncProto = True,
+                 indentFuncPointer = False,
+                 alignFuncParam = 0):
+        GeneratorOptions.__init__(self, filename, directory, apiname, profile,
+                                  versions, emitversions, defaultExtensions,
+                                  addExtensions, removeExtensions, sortProcedure)
+        self.prefixText      = prefixText
+        self.protectFeature  = protectFeature
+        self.apicall         = apicall
+        self.apientry        = apientry
+        self.apientryp       = apientryp
+        self.indentFuncProto = indentFuncProto
+        self.indentFuncPointer = indentFuncPointer
+        self.alignFuncParam  = alignFuncParam
+
+# ProfilingLayerOutputGenerator - subclass of OutputGenerator.
+# Generates a layer counting and timing the calls to every entrypoint
+#
+# ---- methods ----
+# ProfilingLayerOutputGenerator(errFile, warnFile, diagFile) - args as for
+#   OutputGenerator. Defines additional internal state.
+# ---- methods overriding base class ----
+# beginFile(genOpts)
+# endFile()
+# beginFeature(interface, emit)
+# endFeature()
+# genCmd(cmdinfo)
+class ProfilingLayerOutputGenerator(OutputGenerator):
+    """Generate a profiling layer source file"""
+    # Commands with manually implemented function bodies, they are not counted
+    MANUAL_FUNCTIONS = [
+        'vkGetDeviceProcAddr',
+        'vkGetInstanceProcAddr',
+        'vkCreateDevice',
+        'vkDestroyDevice',
+        'vkCreateInstance',
+        'vkDestroyInstance',
+        'vkEnumerateInstanceLayerProperties',
+        'vkEnumerateInstanceExtensionProperties',
+        'vkEnumerateDeviceLayerProperties',
+        'vkEnumerateDeviceExtensionProperties',
+    ]
+    def __init__(self,
+                 errFile = sys.stderr,
+                 warnFile = sys.stderr,
+                 diagFile = sys.stdout):
+        OutputGenerator.__init__(self, errFile, warnFile, diagFile)
+        # Internal state - accumulators for the text written at endFile(), once
+        # the number of profiled commands is known
+        self.command_names = []
+        self.declarations = []
+        self.wrappers = []
+        self.intercepts = []
+
+    # Check if an object is a dispatchable handle
+    def isHandleTypeDispatchable(self, handletype):
+        handle = self.registry.tree.find("types/type/[name='" + handletype + "'][@category='handle']")
+        if handle is not None and handle.find('type').text == 'VK_DEFINE_HANDLE':
+            return True
+        else:
+            return False
+
+    def beginFile(self, genOpts):
+        OutputGenerator.beginFile(self, genOpts)
+        # User-supplied prefix text, if any (list of strings)
+        if (genOpts.prefixText):
+            for s in genOpts.prefixText:
+                write(s, file=self.outFile)
+        write('#include <assert.h>', file=self.outFile)
+        write('#include <stdio.h>', file=self.outFile)
+        write('#include <stdlib.h>', file=self.outFile)
+        write('#include <string.h>', file=self.outFile)
+        write('#include <algorithm>', file=self.outFile)
+        write('#include <atomic>', file=self.outFile)
+        write('#include <chrono>', file=self.outFile)
+        write('#include <mutex>', file=self.outFile)
+        write('#include <string>', file=self.outFile)
+        write('#include <unordered_map>', file=self.outFile)
+        write('#include <vector>', file=self.outFile)
+        write('#include <vulkan/vulkan.h>', file=self.outFile)
+        write('#include <vulkan/vk_layer.h>', file=self.outFile)
+        write('#include "vk_layer_dispatch_table.h"', file=self.outFile)
+        write('#include "vk_dispatch_table_helper.h"', file=self.outFile)
+        self.newline()
+        write('namespace profiling {', file=self.outFile)
+
+    def endFile(self):
+        self.newline()
+        write('// Entrypoints counted by this layer', file=self.outFile)
+        write('enum profiled_command {', file=self.outFile)
+        write('\n'.join(['    CMD_%s,' % name for name in self.command_names]), file=self.outFile)
+        write('    COMMAND_COUNT', file=self.outFile)
+        write('};', file=self.outFile)
+        self.newline()
+        write('static const char *const command_names[COMMAND_COUNT] = {', file=self.outFile)
+        write('\n'.join(['    "%s",' % name for name in self.command_names]), file=self.outFile)
+        write('};', file=self.outFile)
+        write(SOURCE_CPP_PREFIX, file=self.outFile)
+        write('\n'.join(self.declarations), file=self.outFile)
+        write('\n'.join(self.wrappers), file=self.outFile)
+        self.newline()
+        # Record intercepted procedures
+        write('// Map of all APIs to be intercepted by this layer', file=self.outFile)
+        write('static const std::unordered_map<std::string, void*> name_to_funcptr_map = {', file=self.outFile)
+        write('\n'.join(self.intercepts), file=self.outFile)
+        write('};', file=self.outFile)
+        write(SOURCE_CPP_POSTFIX, file=self.outFile)
+        # Finish processing in superclass
+        OutputGenerator.endFile(self)
+    #
+    # Add a line to the intercept map, under the current feature's protection
+    def addIntercept(self, name):
+        if (self.featureExtraProtect != None):
+            self.intercepts += [ '#ifdef %s' % self.featureExtraProtect ]
+        self.intercepts += [ '    {"%s", (void*)%s},' % (name,name[2:]) ]
+        if (self.featureExtraProtect != None):
+            self.intercepts += [ '#endif' ]
+    #
+    # Command generation
+    def genCmd(self, cmdinfo, name):
+        OutputGenerator.genCmd(self, cmdinfo, name)
+        decls = self.makeCDecls(cmdinfo.elem)
+        if name in self.MANUAL_FUNCTIONS:
+            self.declarations += [ 'static %s' % (decls[0]) ]
+            self.addIntercept(name)
+            return
+        # Global commands have no dispatchable handle to find the dispatch table with
+        dispatchable_type = cmdinfo.elem.find('param/type').text
+        dispatchable_name = cmdinfo.elem.find('param/name').text
+        if not self.isHandleTypeDispatchable(dispatchable_type):
+            return
+        command_id = 'CMD_' + name
+        self.command_names.append(name)
+        self.addIntercept(name)
+
+        wrapper = []
+        if (self.featureExtraProtect != None):
+            wrapper.append('#ifdef %s' % self.featureExtraProtect)
+        wrapper.append('static %s' % (decls[0][:-1]))
+        wrapper.append('{')
+        wrapper.append('    layer_data *my_data = get_layer_data(%s);' % dispatchable_name)
+        if dispatchable_type in ['VkInstance', 'VkPhysicalDevice']:
+            table = 'my_data->instance_dispatch_table.'
+        else:
+            table = 'my_data->device_dispatch_table.'
+        # Declare result variable, if any.
+        resulttype = cmdinfo.elem.find('proto/type')
+        if (resulttype != None and resulttype.text == 'void'):
+          resulttype = None
+        if (resulttype != None):
+            assignresult = resulttype.text + ' result = '
+        else:
+            assignresult = ''
+        params = cmdinfo.elem.findall('param/name')
+        paramstext = ', '.join([str(param.text) for param in params])
+        wrapper.append('    thread_profile *profile;')
+        wrapper.append('    uint64_t start_ns = begin_call(profile, %s);' % command_id)
+        wrapper.append('    ' + assignresult + table + name[2:] + '(' + paramstext + ');')
+        wrapper.append('    end_call(profile, %s, start_ns);' % command_id)
+        if name == 'vkQueuePresentKHR':
+            wrapper.append('    end_frame();')
+        # Return result variable, if any.
+        if (resulttype != None):
+            wrapper.append('    return result;')
+        wrapper.append('}')
+        if (self.featureExtraProtect != None):
+            wrapper.append('#endif // %s' % self.featureExtraProtect)
+        wrapper.append('')
+        self.wrappers += wrapper
+    #
+    # override makeProtoName to drop the "vk" prefix
+    def makeProtoName(self, name, tail):
+        return self.genOpts.apientry + name[2:] + tail